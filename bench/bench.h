@@ -0,0 +1,93 @@
+#pragma once
+
+//  Minimal header-only benchmark harness.
+//
+//  A BENCHMARK(name) body prepares its input and calls benchMeasure() for every
+//  variant it wants to time, so alternatives over the same data print next to each other:
+//
+//      BENCHMARK(centroid) {
+//          std::vector<glm::vec3> pts = makePoints(1000000);
+//          benchMeasure("scalar", [&]{ benchKeep( getCentroid(pts) ); });
+//          benchMeasure("kernel", [&]{ benchKeep( computeCentroid(pts) ); });
+//      }
+//
+//  Only one translation unit (main.cpp) defines BENCH_MAIN.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define BENCH_MIN_TIME      0.5     // seconds spent timing each variant
+#define BENCH_MIN_SAMPLES   5
+#define BENCH_MAX_SAMPLES   1000
+
+struct BenchCase {
+    const char*             name;
+    std::function<void()>   func;
+};
+
+inline std::vector<BenchCase>& getBenchCases() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+struct BenchRegister {
+    BenchRegister(const char* _name, std::function<void()> _func) {
+        getBenchCases().push_back( { _name, _func } );
+    }
+};
+
+#define BENCHMARK(_name) \
+    static void bench_##_name(); \
+    static BenchRegister bench_register_##_name(#_name, bench_##_name); \
+    static void bench_##_name()
+
+//  Keep the compiler from optimizing away a result that is otherwise unused
+template<typename T>
+inline void benchKeep(const T& _value) {
+    asm volatile("" : : "r,m"(_value) : "memory");
+}
+
+//  Run _func repeatedly and print the min and median time of one call
+inline void benchMeasure(const std::string& _label, const std::function<void()>& _func) {
+    typedef std::chrono::high_resolution_clock clock;
+
+    // Warm up caches and the thread pool
+    _func();
+
+    std::vector<double> samples;
+    double total = 0.0;
+    while ( (total < BENCH_MIN_TIME || samples.size() < BENCH_MIN_SAMPLES) && samples.size() < BENCH_MAX_SAMPLES ) {
+        clock::time_point start = clock::now();
+        _func();
+        double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        samples.push_back(elapsed);
+        total += elapsed;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    printf("    %-32s min %10.3f ms   median %10.3f ms   (%zu runs)\n", _label.c_str(), samples.front() * 1000.0, samples[samples.size() / 2] * 1000.0, samples.size());
+}
+
+#ifdef BENCH_MAIN
+//  Runs every benchmark, or only the ones whose name contains one of the arguments
+int main(int argc, char **argv) {
+    std::vector<BenchCase>& cases = getBenchCases();
+    for (size_t i = 0; i < cases.size(); i++) {
+        bool selected = (argc < 2);
+        for (int a = 1; a < argc && !selected; a++) {
+            selected = strstr(cases[i].name, argv[a]) != nullptr;
+        }
+
+        if (selected) {
+            printf("%s\n", cases[i].name);
+            cases[i].func();
+        }
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "inputs.h"
+
+#include <cmath>
+
+#include "tools/geom.h"
+#include "tools/geomKernels.h"
+#include "tools/parallel.h"
+
+//  What Mesh::computeNormals used to do: scatter normalized face normals into the vertices
+static void computeNormalsScalar(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, std::vector<glm::vec3> &_normals) {
+    std::vector<glm::vec3> norm(_vertices.size(), glm::vec3(0.0));
+    for (size_t t = 0; t < _indices.size() / 3; t++) {
+        int i1 = _indices[3 * t];
+        int i2 = _indices[3 * t + 1];
+        int i3 = _indices[3 * t + 2];
+        glm::vec3 dir = glm::normalize(glm::cross(_vertices[i2] - _vertices[i1], _vertices[i3] - _vertices[i1]));
+        norm[i1] += dir;
+        norm[i2] += dir;
+        norm[i3] += dir;
+    }
+
+    _normals.clear();
+    for (size_t i = 0; i < norm.size(); i++) {
+        _normals.push_back(glm::normalize(norm[i]));
+    }
+}
+
+static void getBoundingBoxScalar(const std::vector<glm::vec3> &_pts, glm::vec3 &_min, glm::vec3 &_max) {
+    _min = _max = _pts[0];
+    for (size_t i = 0; i < _pts.size(); i++) {
+        _min = glm::min(_min, _pts[i]);
+        _max = glm::max(_max, _pts[i]);
+    }
+}
+
+BENCHMARK(geomKernels) {
+    std::vector<glm::vec3> vertices;
+    std::vector<INDEX_TYPE> indices;
+    makeSphere(2000, 2000, vertices, indices);
+    printf("    %zu vertices, %zu triangles, %u threads\n", vertices.size(), indices.size() / 3, getNumThreads());
+
+    std::vector<glm::vec3> normals;
+    benchMeasure("normals scalar", [&]{ computeNormalsScalar(vertices, indices, normals); benchKeep(normals[0]); });
+    benchMeasure("normals computeVertexNormals", [&]{ computeVertexNormals(vertices, indices, normals); benchKeep(normals[0]); });
+
+    benchMeasure("centroid getCentroid", [&]{ benchKeep( getCentroid(vertices) ); });
+    benchMeasure("centroid computeCentroid", [&]{ benchKeep( computeCentroid(vertices) ); });
+
+    glm::vec3 min, max;
+    benchMeasure("aabb scalar", [&]{ getBoundingBoxScalar(vertices, min, max); benchKeep(min); benchKeep(max); });
+    benchMeasure("aabb computeBoundingBox", [&]{ computeBoundingBox(vertices, min, max); benchKeep(min); benchKeep(max); });
+
+    benchMeasure("bounds computeBounds", [&]{ benchKeep( computeBounds(vertices).radius ); });
+}
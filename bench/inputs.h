@@ -0,0 +1,49 @@
+#pragma once
+
+//  Synthetic inputs shared by the benchmarks. They are generated when the benchmark that
+//  needs them starts, so every run (and every machine) measures the same data.
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tools/geom.h"
+#include "gl/vbo.h"
+
+//  A wavy sphere of _rows x _cols vertices, two triangles per quad
+inline void makeSphere(size_t _rows, size_t _cols, std::vector<glm::vec3> &_vertices, std::vector<INDEX_TYPE> &_indices) {
+    _vertices.resize(_rows * _cols);
+    for (size_t r = 0; r < _rows; r++) {
+        float theta = PI * r / (_rows - 1);
+        for (size_t c = 0; c < _cols; c++) {
+            float phi = TWO_PI * c / _cols;
+            float radius = 1.0 + 0.1 * sin(phi * 8.0) * sin(theta * 6.0);
+            _vertices[r * _cols + c] = radius * glm::vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        }
+    }
+
+    _indices.clear();
+    _indices.reserve((_rows - 1) * _cols * 6);
+    for (size_t r = 0; r + 1 < _rows; r++) {
+        for (size_t c = 0; c < _cols; c++) {
+            INDEX_TYPE a = r * _cols + c;
+            INDEX_TYPE b = r * _cols + (c + 1) % _cols;
+            INDEX_TYPE d = (r + 1) * _cols + c;
+            INDEX_TYPE e = (r + 1) * _cols + (c + 1) % _cols;
+            _indices.push_back(a); _indices.push_back(d); _indices.push_back(b);
+            _indices.push_back(b); _indices.push_back(d); _indices.push_back(e);
+        }
+    }
+}
+
+//  Where the benchmarks write the files they generate
+inline std::string getBenchPath(const std::string& _name) {
+    return "/tmp/glslViewer_bench_" + _name;
+}
+
+inline bool writeBenchFile(const std::string& _path, const std::string& _content) {
+    std::ofstream file(_path.c_str());
+    file << _content;
+    return file.good();
+}
@@ -0,0 +1,108 @@
+#include "bench.h"
+#include "inputs.h"
+
+#include "tools/fs.h"
+#include "tools/text.h"
+#include "gl/strings.h"
+#include "gl/texture.h"
+#include "gl/uniform.h"
+#include "types/mesh.h"
+
+//  A console session worth of uniforms: floats, vectors and ints, over and over
+BENCHMARK(parseUniforms) {
+    std::vector<std::string> lines;
+    for (int i = 0; i < 10000; i++) {
+        std::string name = "u_value" + toString(i % 100);
+        switch (i % 4) {
+            case 0: lines.push_back(name + "," + toString(i * 0.5)); break;
+            case 1: lines.push_back(name + ",0.5,0.25"); break;
+            case 2: lines.push_back(name + ",1.0,0.5,0.25,1.0"); break;
+            default: lines.push_back(name + "," + toString(i)); break;
+        }
+    }
+
+    benchMeasure("10000 lines", [&]{
+        UniformList uniforms;
+        for (size_t i = 0; i < lines.size(); i++) {
+            benchKeep( parseUniforms(lines[i], &uniforms) );
+        }
+        benchKeep( uniforms.size() );
+    });
+}
+
+//  A shader that includes a chain of files, each with some code and the next #include
+BENCHMARK(loadFromPath) {
+    const int depth = 64;
+    std::string body;
+    for (int l = 0; l < 50; l++) {
+        body += "float f" + toString(l) + "(float x) { return x * " + toString(l) + ".0 + sin(x); }\n";
+    }
+
+    for (int i = 0; i < depth; i++) {
+        std::string content = "// level " + toString(i) + "\n";
+        if (i + 1 < depth) {
+            content += "#include \"" + getBenchPath("include" + toString(i + 1) + ".glsl") + "\"\n";
+        }
+        writeBenchFile(getBenchPath("include" + toString(i) + ".glsl"), content + body);
+    }
+    std::string main = getBenchPath("main.frag");
+    writeBenchFile(main, "#include \"" + getBenchPath("include0.glsl") + "\"\nvoid main() {\n    gl_FragColor = vec4(f1(0.5));\n}\n");
+
+    std::vector<std::string> folders;
+    benchMeasure("64 nested includes", [&]{
+        std::string source;
+        benchKeep( loadFromPath(main, &source, folders) );
+        benchKeep( source.size() );
+    });
+}
+
+//  ASCII PLY of a sphere with normals, as Mesh::save writes them
+BENCHMARK(plyLoad) {
+    std::vector<glm::vec3> vertices;
+    std::vector<INDEX_TYPE> indices;
+    makeSphere(300, 300, vertices, indices);
+
+    Mesh sphere;
+    sphere.addVertices(vertices);
+    sphere.addIndices(indices);
+    sphere.computeNormals();
+
+    std::string path = getBenchPath("sphere.ply");
+    sphere.save(path);
+
+    benchMeasure("90k vertices", [&]{
+        Mesh mesh;
+        benchKeep( mesh.load(path) );
+        benchKeep( mesh.getVertices().size() );
+    });
+}
+
+//  Screenshots are flipped (and compressed) on the CPU
+BENCHMARK(savePixels) {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<unsigned char> pixels(width * height * 4);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = (i * 7 + i / 4096) & 0xFF;
+    }
+
+    std::string path = getBenchPath("screenshot.png");
+    benchMeasure("1920x1080", [&]{
+        benchKeep( Texture::savePixels(path, pixels.data(), width, height) );
+    });
+}
+
+//  The inspector looks up the name of every GLenum it shows
+BENCHMARK(getString) {
+    const GLenum enums[] = { GL_FLOAT, GL_FLOAT_VEC2, GL_FLOAT_VEC3, GL_FLOAT_VEC4, GL_INT, GL_BOOL,
+                             GL_FLOAT_MAT4, GL_SAMPLER_2D, GL_TRIANGLES, GL_RGBA8, GL_TEXTURE_2D, 0x12345 };
+    const size_t count = sizeof(enums) / sizeof(enums[0]);
+
+    benchMeasure("100000 lookups", [&]{
+        size_t length = 0;
+        for (size_t i = 0; i < 100000; i++) {
+            length += getString(enums[i % count]).size();
+        }
+        benchKeep( length );
+    });
+}
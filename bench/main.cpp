@@ -0,0 +1,2 @@
+#define BENCH_MAIN
+#include "bench.h"
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "inputs.h"
+
+#include "tools/geom.h"
+#include "types/mesh.h"
+
+static Mesh makeSphereMesh(size_t _rows, size_t _cols) {
+    std::vector<glm::vec3> vertices;
+    std::vector<INDEX_TYPE> indices;
+    makeSphere(_rows, _cols, vertices, indices);
+
+    Mesh mesh;
+    mesh.addVertices(vertices);
+    mesh.addIndices(indices);
+    return mesh;
+}
+
+//  Interleaving positions, normals and texture coordinates for the Vbo (uploaded on the first
+//  draw, so no context is needed)
+BENCHMARK(meshGetVbo) {
+    Mesh mesh = makeSphereMesh(1000, 1000);
+    mesh.computeNormals();
+    std::vector<glm::vec2> uvs(mesh.getVertices().size(), glm::vec2(0.5));
+    mesh.addTexCoords(uvs);
+
+    benchMeasure("getVertexData 1M", [&]{
+        benchKeep( mesh.getVertexData().size() );
+    });
+    benchMeasure("getVbo 1M", [&]{
+        Vbo* vbo = mesh.getVbo();
+        benchKeep( vbo );
+        delete vbo;
+    });
+}
+
+BENCHMARK(meshComputeNormals) {
+    Mesh mesh = makeSphereMesh(1000, 1000);
+    benchMeasure("1M vertices", [&]{
+        mesh.computeNormals();
+        benchKeep( mesh.getNormals().size() );
+    });
+}
+
+//  Points of the sphere flattened on the XZ plane
+BENCHMARK(convexHull) {
+    std::vector<glm::vec3> vertices;
+    std::vector<INDEX_TYPE> indices;
+    makeSphere(300, 300, vertices, indices);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        vertices[i].y = 0.0;
+    }
+
+    benchMeasure("90k points", [&]{
+        benchKeep( getConvexHull(vertices).size() );
+    });
+}
+
+//  A noisy polyline around the equator
+BENCHMARK(simplify) {
+    std::vector<glm::vec3> line(100000);
+    for (size_t i = 0; i < line.size(); i++) {
+        float a = TWO_PI * i / line.size();
+        float r = 1.0 + 0.01 * sin(a * 977.0) + 0.05 * sin(a * 13.0);
+        line[i] = glm::vec3(cos(a) * r, sin(a) * r, 0.0);
+    }
+
+    benchMeasure("100k points", [&]{
+        std::vector<glm::vec3> pts = line;
+        simplify(pts, 0.001f);
+        benchKeep( pts.size() );
+    });
+}
@@ -3,6 +3,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include "glm/gtc/matrix_transform.hpp"
+#include "gl/fbo.h"
 #include "tools/text.h"
 #include <imgui/imgui.h>
 #include "ui/imgui_impl_glfw_gl3.h"
@@ -10,6 +11,7 @@
 // Common global variables
 //----------------------------------------------------
 const std::string appTitle = "glslViewer";
+std::string windowTitle(64, ' ');  // memory for the title with the FPS, taken at startup
 static glm::mat4 orthoMatrix;
 typedef struct {
     float     x,y;
@@ -29,9 +31,11 @@ static float fPixelDensity = 1.0;
 
 #ifdef PLATFORM_RPI
 #include <assert.h>
+#include <cstdio>
 #include <fcntl.h>
 #include <iostream>
 #include <termios.h>
+#include <unistd.h>
 #include <string>
 #include <fstream>
 
@@ -333,18 +337,84 @@ bool isGL(){
 }
 
 #ifndef PLATFORM_RPI
-void debounceSetWindowTitle(std::string title){
+bool debounceSetWindowTitle(const std::string& title){
     static double lastUpdated;
 
     double now = glfwGetTime();
 
     if ((now - lastUpdated) < 1.) {
-        return;
+        return false;
     }
 
     glfwSetWindowTitle(window, title.c_str());
 
     lastUpdated = now;
+    return true;
+}
+#endif
+
+#ifdef PLATFORM_RPI
+// Read the mouse straight from the driver and launch its events
+void readMouse() {
+    static int fd = -1;
+    const int XSIGN = 1<<4, YSIGN = 1<<5;
+    if (fd<0) {
+        fd = open("/dev/input/mouse0",O_RDONLY|O_NONBLOCK);
+    }
+    if (fd>=0) {
+        // Set values to 0
+        mouse.velX=0;
+        mouse.velY=0;
+
+        // Extract values from driver
+        struct {char buttons, dx, dy; } m;
+        while (1) {
+            int bytes = read(fd, &m, sizeof m);
+
+            if (bytes < (int)sizeof m) {
+                return;
+            } else if (m.buttons&8) {
+                break; // This bit should always be set
+            }
+
+            read(fd, &m, 1); // Try to sync up again
+        }
+
+        // Set button value
+        int button = m.buttons&3;
+        if (button) mouse.button = button;
+        else mouse.button = 0;
+
+        // Set deltas
+        mouse.velX=m.dx;
+        mouse.velY=m.dy;
+        if (m.buttons&XSIGN) mouse.velX-=256;
+        if (m.buttons&YSIGN) mouse.velY-=256;
+
+        // Add movement
+        mouse.x+=mouse.velX;
+        mouse.y+=mouse.velY;
+
+        // Clamp values
+        if (mouse.x < 0) mouse.x=0;
+        if (mouse.y < 0) mouse.y=0;
+        if (mouse.x > viewport.z) mouse.x = viewport.z;
+        if (mouse.y > viewport.w) mouse.y = viewport.w;
+
+        // Lunch events
+        if (mouse.button == 0 && button != mouse.button) {
+            mouse.button = button;
+            onMouseClick(mouse.x, mouse.y, mouse.button);
+        }
+        else {
+            mouse.button = button;
+        }
+
+        if (mouse.velX != 0.0 || mouse.velY != 0.0) {
+            if (button != 0) onMouseDrag(mouse.x, mouse.y, mouse.button);
+            else onMouseMove(mouse.x, mouse.y);
+        }
+    }
 }
 #endif
 
@@ -373,94 +443,83 @@ void updateGL(){
         fFPS = double(frame_count);
         frame_count = 0;
         lastTime -= 1.;
+
+    #ifndef PLATFORM_RPI
+        // Only when the FPS shown change, formatted into the memory of windowTitle so steady
+        // frames don't allocate
+        static double titleFps = -1.0;
+        if (fFPS != titleFps) {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%s:..: FPS:%g", appTitle.c_str(), fFPS);
+            windowTitle.assign(buffer);
+            if (debounceSetWindowTitle(windowTitle)) {
+                titleFps = fFPS;
+            }
+        }
+    #endif
     }
 
     // EVENTS
     // --------------------------------------------------------------------
     #ifdef PLATFORM_RPI
         // RASPBERRY_PI
-        static int fd = -1;
-        const int XSIGN = 1<<4, YSIGN = 1<<5;
-        if (fd<0) {
-            fd = open("/dev/input/mouse0",O_RDONLY|O_NONBLOCK);
-        }
-        if (fd>=0) {
-            // Set values to 0
-            mouse.velX=0;
-            mouse.velY=0;
-
-            // Extract values from driver
-            struct {char buttons, dx, dy; } m;
-            while (1) {
-                int bytes = read(fd, &m, sizeof m);
-
-                if (bytes < (int)sizeof m) {
-                    return;
-                } else if (m.buttons&8) {
-                    break; // This bit should always be set
-                }
-
-                read(fd, &m, 1); // Try to sync up again
-            }
-
-            // Set button value
-            int button = m.buttons&3;
-            if (button) mouse.button = button;
-            else mouse.button = 0;
-
-            // Set deltas
-            mouse.velX=m.dx;
-            mouse.velY=m.dy;
-            if (m.buttons&XSIGN) mouse.velX-=256;
-            if (m.buttons&YSIGN) mouse.velY-=256;
-
-            // Add movement
-            mouse.x+=mouse.velX;
-            mouse.y+=mouse.velY;
-
-            // Clamp values
-            if (mouse.x < 0) mouse.x=0;
-            if (mouse.y < 0) mouse.y=0;
-            if (mouse.x > viewport.z) mouse.x = viewport.z;
-            if (mouse.y > viewport.w) mouse.y = viewport.w;
-
-            // Lunch events
-            if (mouse.button == 0 && button != mouse.button) {
-                mouse.button = button;
-                onMouseClick(mouse.x, mouse.y, mouse.button);
-            }
-            else {
-                mouse.button = button;
-            }
-
-            if (mouse.velX != 0.0 || mouse.velY != 0.0) {
-                if (button != 0) onMouseDrag(mouse.x, mouse.y, mouse.button);
-                else onMouseMove(mouse.x, mouse.y);
-            }
-        }
+        readMouse();
     #else
-        std::string title = appTitle + ":..: FPS:" + toString(fFPS);
-        debounceSetWindowTitle(title);
-
         // OSX/LINUX
         glfwPollEvents();
         ImGui_ImplGlfwGL3_NewFrame();
     #endif
 }
 
-void renderGL(){
+void renderGL(GpuTimer* _guiTimer){
     #ifdef PLATFORM_RPI
         // RASPBERRY_PI
         eglSwapBuffers(display, surface);
     #else
         // OSX/LINUX
+        // The GUI is recorded during the frame, and only reaches the GPU here
+        if (_guiTimer != nullptr) {
+            _guiTimer->begin();
+        }
         ImGui::Render();
         ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
+        if (_guiTimer != nullptr) {
+            _guiTimer->end();
+        }
 
         glfwSwapBuffers(window);
     #endif
 }
 
+void waitGL(double _timeout) {
+    #ifdef PLATFORM_RPI
+        // RASPBERRY_PI
+        // There is no event loop, the mouse is read at about 60Hz
+        if (_timeout > 1.0/60.0) {
+            _timeout = 1.0/60.0;
+        }
+        if (_timeout > 0.0) {
+            usleep(_timeout * 1000000);
+        }
+        readMouse();
+    #else
+        // OSX/LINUX
+        if (_timeout > 0.0) {
+            glfwWaitEventsTimeout(_timeout);
+        }
+        else {
+            glfwPollEvents();
+        }
+    #endif
+}
+
+void wakeGL() {
+    #ifndef PLATFORM_RPI
+        // OSX/LINUX
+        glfwPostEmptyEvent();
+    #endif
+}
+
 void closeGL(){
     #ifdef PLATFORM_RPI
         // RASPBERRY_PI
@@ -489,11 +548,22 @@ void setWindowSize(int _width, int _height) {
     viewport.w = _height;
     fPixelDensity = getPixelDensity();
     glViewport(0.0, 0.0, (float)getWindowWidth(), (float)getWindowHeight());
+    Fbo::setScreenViewport(0, 0, getWindowWidth(), getWindowHeight());
     orthoMatrix = glm::ortho((float)viewport.x, (float)getWindowWidth(), (float)viewport.y, (float)getWindowHeight());
 
     onViewportResize(getWindowWidth(), getWindowHeight());
 }
 
+void setVSync(bool _on) {
+    #ifdef PLATFORM_RPI
+        // RASPBERRY_PI
+        eglSwapInterval(display, _on? 1 : 0);
+    #else
+        // OSX/LINUX
+        glfwSwapInterval(_on? 1 : 0);
+    #endif
+}
+
 glm::ivec2 getScreenSize() {
     glm::ivec2 screen;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gl/gl.h"
+#include "gl/gpuTimer.h"
 #include "glm/glm.hpp"
 
 //	GL Context
@@ -8,12 +9,18 @@
 void initGL(glm::ivec4 &_viewport, bool _headless = false);
 bool isGL();
 void updateGL();
-void renderGL();
+//  Draw the GUI, timing it on the GPU with _guiTimer when there is one, and swap the buffers
+void renderGL(GpuTimer* _guiTimer = nullptr);
+//  Sleep until there are input events (they are processed) or _timeout seconds have passed
+void waitGL(double _timeout);
+//  Wake up a waitGL() from any thread
+void wakeGL();
 void closeGL();
 
 //	SET
 //----------------------------------------------
 void setWindowSize(int _width, int _height);
+void setVSync(bool _on);
 
 //	GET
 //----------------------------------------------
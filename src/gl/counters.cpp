@@ -0,0 +1,3 @@
+#include "counters.h"
+
+GlCounters glCounters;
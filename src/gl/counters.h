@@ -0,0 +1,15 @@
+#pragma once
+
+//  What the GL layer did in the current frame and the GPU memory it holds, for the `stats`
+//  command and the performance overlay. Plain counters, added to where it happens
+struct GlCounters {
+    unsigned long   drawCalls = 0;      // glDrawElements and glDrawArrays of the Vbos
+    unsigned long   uniformCalls = 0;   // uniforms set (each one looks its location up)
+    long long       textureBytes = 0;   // images, and the color and depth buffers of the Fbos
+    long long       bufferBytes = 0;    // vertex and index buffers
+
+    //  The calls are per frame, the memory is what is allocated now
+    void resetFrame() { drawCalls = 0; uniformCalls = 0; }
+};
+
+extern GlCounters glCounters;
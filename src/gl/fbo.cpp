@@ -24,14 +24,71 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "fbo.h"
+#include "counters.h"
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
-Fbo::Fbo():m_id(0), m_old_fbo_id(0), m_texture(0), m_depth_buffer(0), m_width(0), m_height(0), m_allocated(false), m_binded(false) {
+#ifndef PLATFORM_RPI
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_R32F
+#define GL_R32F 0x822E
+#endif
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+#endif
+
+namespace {
+
+typedef void (*InvalidateFramebufferFunc)(GLenum _target, GLsizei _numAttachments, const GLenum* _attachments);
+
+//  glInvalidateFramebuffer (OpenGL 4.3) or glDiscardFramebufferEXT (OpenGL ES), when the driver has them
+InvalidateFramebufferFunc getInvalidateFramebuffer() {
+    static bool checked = false;
+    static InvalidateFramebufferFunc func = nullptr;
+
+    if (!checked) {
+        checked = true;
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+#if defined(PLATFORM_RPI)
+        if (extensions != nullptr && strstr(extensions, "GL_EXT_discard_framebuffer") != nullptr) {
+            func = (InvalidateFramebufferFunc)eglGetProcAddress("glDiscardFramebufferEXT");
+        }
+#elif defined(PLATFORM_LINUX)
+        int major = 0, minor = 0;
+        const char* version = (const char*)glGetString(GL_VERSION);
+        if (version != nullptr) {
+            sscanf(version, "%d.%d", &major, &minor);
+        }
+        if (major * 10 + minor >= 43 || (extensions != nullptr && strstr(extensions, "GL_ARB_invalidate_subdata") != nullptr)) {
+            func = glInvalidateFramebuffer;
+        }
+#endif
+    }
+    return func;
+}
+
+}
+
+const Fbo* Fbo::s_bound = nullptr;
+GLint Fbo::s_screenViewport[4] = { 0, 0, 0, 0 };
+
+Fbo::Fbo():m_id(0), m_previous(nullptr), m_texture(0), m_depth_buffer(0), m_width(0), m_height(0), m_format(FBO_RGBA8), m_bytes(0), m_allocated(false), m_binded(false) {
 }
 
 Fbo::~Fbo() {
     unbind();
-    if (m_allocated) {
+    glCounters.textureBytes -= m_bytes;
+    if (m_id != 0) {
         glDeleteTextures(1, &m_texture);
         glDeleteRenderbuffers(1, &m_depth_buffer);
         glDeleteFramebuffers(1, &m_id);
@@ -39,29 +96,101 @@ Fbo::~Fbo() {
     }
 }
 
-void Fbo::allocate(const uint _width, const uint _height, bool _depth) {
-    if (!m_allocated) {
+bool Fbo::parseFormat(const std::string& _name, FboFormat& _format) {
+    if (_name == "RGBA8") {
+        _format = FBO_RGBA8;
+    }
+    else if (_name == "RGBA16F") {
+        _format = FBO_RGBA16F;
+    }
+    else if (_name == "RGBA32F") {
+        _format = FBO_RGBA32F;
+    }
+    else if (_name == "R32F") {
+        _format = FBO_R32F;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool Fbo::parseLoad(const std::string& _name, FboLoad& _load) {
+    if (_name == "clear") {
+        _load = FBO_LOAD_CLEAR;
+    }
+    else if (_name == "dont_care") {
+        _load = FBO_LOAD_DONT_CARE;
+    }
+    else if (_name == "preserve") {
+        _load = FBO_LOAD_PRESERVE;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+void Fbo::setScreenViewport(int _x, int _y, int _width, int _height) {
+    s_screenViewport[0] = _x;
+    s_screenViewport[1] = _y;
+    s_screenViewport[2] = _width;
+    s_screenViewport[3] = _height;
+}
+
+void Fbo::allocate(const uint _width, const uint _height, bool _depth, FboFormat _format) {
+    if (m_allocated && m_width == _width && m_height == _height && m_format == _format && _depth == (m_depth_buffer != 0)) {
+        return;
+    }
+
+    if (m_id == 0) {
         // Create a frame buffer
         glGenFramebuffers(1, &m_id);
 
         // Generate a texture to hold the colour buffer
         glGenTextures(1, &m_texture);
+    }
 
-        if (_depth) {
-            // Create a texture to hold the depth buffer
-            glGenRenderbuffers(1, &m_depth_buffer);
-        }
+    if (_depth && m_depth_buffer == 0) {
+        // Create a texture to hold the depth buffer
+        glGenRenderbuffers(1, &m_depth_buffer);
     }
 
-    // if (m_width != _width || m_height != _height) {
+    {
         m_width = _width;
         m_height = _height;
+        m_format = _format;
+
+        GLenum internalFormat = GL_RGBA;
+        GLenum format = GL_RGBA;
+        GLenum type = GL_UNSIGNED_BYTE;
+#ifdef PLATFORM_RPI
+        // OpenGL ES 2.0 can't render to floating point textures
+        if (m_format != FBO_RGBA8) {
+            std::cerr << "Floating point buffers are not supported, using RGBA8" << std::endl;
+            m_format = FBO_RGBA8;
+        }
+#else
+        if (m_format == FBO_RGBA16F) {
+            internalFormat = GL_RGBA16F;
+            type = GL_HALF_FLOAT;
+        }
+        else if (m_format == FBO_RGBA32F) {
+            internalFormat = GL_RGBA32F;
+            type = GL_FLOAT;
+        }
+        else if (m_format == FBO_R32F) {
+            internalFormat = GL_R32F;
+            format = GL_RED;
+            type = GL_FLOAT;
+        }
+#endif
 
-        bind();
+        bind(FBO_LOAD_PRESERVE);
 
         // Color
         glBindTexture(GL_TEXTURE_2D, m_texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height,0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height,0, format, type, NULL);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -79,9 +208,30 @@ void Fbo::allocate(const uint _width, const uint _height, bool _depth) {
 #endif
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth_buffer);
         }
+        else if (m_depth_buffer != 0) {
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
+            glDeleteRenderbuffers(1, &m_depth_buffer);
+            m_depth_buffer = 0;
+        }
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
-            m_allocated = true;
+        // Bytes per pixel of the color buffer, and of the depth buffer (24 bits are stored in 4)
+        long long pixelBytes = (m_format == FBO_RGBA16F)? 8 : (m_format == FBO_RGBA32F)? 16 : 4;
+        if (m_depth_buffer != 0) {
+#ifdef PLATFORM_RPI
+            pixelBytes += 2;
+#else
+            pixelBytes += 4;
+#endif
+        }
+        glCounters.textureBytes += pixelBytes * m_width * m_height - m_bytes;
+        m_bytes = pixelBytes * m_width * m_height;
+
+        // Start from transparent black, whatever is loaded when binding it later
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        m_allocated = complete;
+        if (complete) {
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT | (m_depth_buffer? GL_DEPTH_BUFFER_BIT : 0));
         }
         unbind();
 
@@ -89,30 +239,86 @@ void Fbo::allocate(const uint _width, const uint _height, bool _depth) {
         if (_depth){
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
         }
-    // }
+
+        if (!complete && m_format != FBO_RGBA8) {
+            std::cerr << "Can't render to this floating point format, using RGBA8" << std::endl;
+            allocate(_width, _height, _depth, FBO_RGBA8);
+        }
+    }
 }
 
-void Fbo::bind() {
+void Fbo::bind(FboLoad _load) {
     if (!m_binded) {
-        glGetIntegerv(GL_FRAMEBUFFER_BINDING, (GLint *)&m_old_fbo_id);
+        // What is bound is tracked here instead of asked to the driver, which can stall it
+        m_previous = s_bound;
+        if (m_previous == nullptr && s_screenViewport[2] == 0) {
+            glGetIntegerv(GL_VIEWPORT, s_screenViewport);
+        }
 
         glBindTexture(GL_TEXTURE_2D, 0);
-        glEnable(GL_TEXTURE_2D);
         glBindFramebuffer(GL_FRAMEBUFFER, m_id);
         glViewport(0.0f, 0.0f, m_width, m_height);
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        if (m_depth_buffer) {
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        } else {
-            glClear(GL_COLOR_BUFFER_BIT);
+
+        if (_load == FBO_LOAD_CLEAR) {
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            if (m_depth_buffer) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            } else {
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+        }
+        else if (_load == FBO_LOAD_DONT_CARE) {
+            invalidate();
         }
+
+        s_bound = this;
         m_binded = true;
     }
 }
 
 void Fbo::unbind() {
     if (m_binded) {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_old_fbo_id);
+        if (m_previous != nullptr) {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_previous->m_id);
+            glViewport(0.0f, 0.0f, m_previous->m_width, m_previous->m_height);
+        }
+        else {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(s_screenViewport[0], s_screenViewport[1], s_screenViewport[2], s_screenViewport[3]);
+        }
+        s_bound = m_previous;
         m_binded = false;
     }
 }
+
+//  Tell the driver the content is not needed, so tiled GPUs don't load it back from memory
+void Fbo::invalidate() {
+    InvalidateFramebufferFunc invalidateFramebuffer = getInvalidateFramebuffer();
+    if (invalidateFramebuffer != nullptr) {
+        GLenum attachment = GL_COLOR_ATTACHMENT0;
+        invalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment);
+    }
+
+    // Depth tests still need it to start from scratch
+    if (m_depth_buffer) {
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+}
+
+bool Fbo::blit(GLuint _fbo, unsigned int _width, unsigned int _height, int _x, int _y) const {
+#ifdef PLATFORM_RPI
+    return false;
+#else
+    if (_width == 0 || _height == 0) {
+        _width = m_width;
+        _height = m_height;
+    }
+    GLenum filter = (_width == m_width && _height == m_height)? GL_NEAREST : GL_LINEAR;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_id);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+    glBlitFramebuffer(0, 0, m_width, m_height, _x, _y, _x + _width, _y + _height, GL_COLOR_BUFFER_BIT, filter);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    return true;
+#endif
+}
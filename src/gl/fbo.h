@@ -1,7 +1,24 @@
 #pragma once
 
+#include <string>
+
 #include "gl.h"
 
+//  Formats of the color buffer
+enum FboFormat {
+    FBO_RGBA8 = 0,
+    FBO_RGBA16F,
+    FBO_RGBA32F,
+    FBO_R32F
+};
+
+//  What happens to the content of the buffers when they are bound
+enum FboLoad {
+    FBO_LOAD_CLEAR = 0,     // cleared to black
+    FBO_LOAD_DONT_CARE,     // undefined, for passes that write every pixel
+    FBO_LOAD_PRESERVE       // kept from the last time they were rendered
+};
+
 class Fbo {
 public:
     Fbo();
@@ -10,21 +27,45 @@ public:
     const GLuint getId() const { return m_id; };
     const GLuint getTextureId() const { return m_texture; };
 
-    void allocate(const unsigned int _width, const unsigned int _height, bool _depth = true);
+    const unsigned int getWidth() const { return m_width; };
+    const unsigned int getHeight() const { return m_height; };
+    const FboFormat getFormat() const { return m_format; };
+
+    void allocate(const unsigned int _width, const unsigned int _height, bool _depth = true, FboFormat _format = FBO_RGBA8);
 
-    void bind();
+    void bind(FboLoad _load = FBO_LOAD_CLEAR);
     void unbind();
 
+    //  Viewport of the screen, restored when the outermost bound Fbo is unbound
+    static void setScreenViewport(int _x, int _y, int _width, int _height);
+
+    //  Copy the color buffer to the framebuffer _fbo (0 is the screen), in a _width x _height rectangle at _x, _y,
+    //  filtering it when the sizes are different (0 keeps the size of this one).
+    //  Returns false where framebuffer blits are not available (OpenGL ES 2.0)
+    bool blit(GLuint _fbo = 0, unsigned int _width = 0, unsigned int _height = 0, int _x = 0, int _y = 0) const;
+
+    //  Parse RGBA8, RGBA16F, RGBA32F or R32F
+    static bool parseFormat(const std::string& _name, FboFormat& _format);
+    //  Parse clear, dont_care or preserve
+    static bool parseLoad(const std::string& _name, FboLoad& _load);
+
 protected:
+    void    invalidate();
+
     GLuint  m_id;
-    GLuint  m_old_fbo_id;
+    const Fbo* m_previous;  // bound before this one (nullptr for the screen)
 
     GLuint  m_texture;
     GLuint  m_depth_buffer;
 
     unsigned int m_width;
     unsigned int m_height;
+    FboFormat    m_format;
+    long long    m_bytes;       // of the color and depth buffers, for the GlCounters
 
     bool    m_allocated;
     bool    m_binded;
+
+    static const Fbo*   s_bound;
+    static GLint        s_screenViewport[4];
 };
@@ -0,0 +1,92 @@
+#include "frameFences.h"
+
+#include <cstdio>
+#include <cstring>
+
+FrameFences::FrameFences(): m_first(0), m_count(0), m_latency(0.0), m_newLatency(false) {
+#ifdef PLATFORM_LINUX
+    memset(m_fences, 0, sizeof(m_fences));
+#endif
+}
+
+FrameFences::~FrameFences() {
+#ifdef PLATFORM_LINUX
+    for (int i = 0; i < m_count; i++) {
+        glDeleteSync(m_fences[(m_first + i) % FRAME_FENCES_MAX]);
+    }
+#endif
+}
+
+bool FrameFences::isSupported() {
+#ifdef PLATFORM_LINUX
+    static int supported = -1;
+    if (supported == -1) {
+        int major = 0, minor = 0;
+        const char* version = (const char*)glGetString(GL_VERSION);
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (version != nullptr) {
+            sscanf(version, "%d.%d", &major, &minor);
+        }
+        supported = (major * 10 + minor >= 32 || (extensions != nullptr && strstr(extensions, "GL_ARB_sync") != nullptr))? 1 : 0;
+    }
+    return supported == 1;
+#else
+    // Neither OpenGL ES 2.0 nor the legacy macOS context have them
+    return false;
+#endif
+}
+
+void FrameFences::insert(std::chrono::steady_clock::time_point _start) {
+#ifdef PLATFORM_LINUX
+    if (!isSupported()) {
+        return;
+    }
+
+    // Too many frames in flight, forget the oldest
+    if (m_count == FRAME_FENCES_MAX) {
+        glDeleteSync(m_fences[m_first]);
+        m_first = (m_first + 1) % FRAME_FENCES_MAX;
+        m_count--;
+    }
+
+    int i = (m_first + m_count) % FRAME_FENCES_MAX;
+    m_fences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_starts[i] = _start;
+    m_count++;
+#endif
+}
+
+void FrameFences::wait(int _frames) {
+#ifdef PLATFORM_LINUX
+    while (m_count > 0) {
+        // Block on the oldest frame while there are too many, just check it otherwise
+        bool block = _frames > 0 && m_count >= _frames;
+        GLenum result = glClientWaitSync(m_fences[m_first], GL_SYNC_FLUSH_COMMANDS_BIT, block? 1000000000 : 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            if (block) {
+                continue;
+            }
+            break;
+        }
+
+        // A failed wait drops the fence, without a measure
+        if (result != GL_WAIT_FAILED) {
+            m_latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_starts[m_first]).count();
+            m_newLatency = true;
+        }
+
+        glDeleteSync(m_fences[m_first]);
+        m_first = (m_first + 1) % FRAME_FENCES_MAX;
+        m_count--;
+    }
+#endif
+}
+
+bool FrameFences::getLatency(double& _milliseconds) {
+    if (!m_newLatency) {
+        return false;
+    }
+    _milliseconds = m_latency;
+    m_newLatency = false;
+    return true;
+}
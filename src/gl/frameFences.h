@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+
+#include "gl.h"
+
+//  Frames that can be tracked at once (and so the most that can be allowed in flight)
+#define FRAME_FENCES_MAX 8
+
+//  A fence after the commands of each frame tells when the GPU is done with it. That bounds
+//  how many frames the CPU queues ahead of the GPU (each one adds its time to the latency
+//  of the input) and measures the latency, from reading the input to the frame being rendered.
+class FrameFences {
+public:
+    FrameFences();
+    virtual ~FrameFences();
+
+    //  Fences are available (OpenGL 3.2 or ARB_sync)
+    static bool isSupported();
+
+    //  Mark the end of the commands of a frame that read its input at _start
+    void    insert(std::chrono::steady_clock::time_point _start);
+
+    //  Wait until there are less than _frames frames the GPU hasn't finished (0 doesn't wait),
+    //  and collect the ones that are done
+    void    wait(int _frames);
+
+    //  Milliseconds from the input to the GPU finishing the newest frame that was seen done
+    //  since the last call, false if none was. Frames are only seen done when wait() is
+    //  called, so without a bound it can be up to a frame late
+    bool    getLatency(double& _milliseconds);
+
+private:
+#ifdef PLATFORM_LINUX
+    GLsync  m_fences[FRAME_FENCES_MAX];
+#endif
+    std::chrono::steady_clock::time_point m_starts[FRAME_FENCES_MAX];
+    int     m_first;    // oldest frame in flight
+    int     m_count;    // frames in flight
+    double  m_latency;
+    bool    m_newLatency;
+};
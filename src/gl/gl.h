@@ -18,3 +18,6 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #endif
+
+//  Wrap the GL calls to count them (cmake -DGL_CALL_COUNTING=ON)
+#include "glCalls.h"
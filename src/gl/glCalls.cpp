@@ -0,0 +1,389 @@
+// The real GL functions are called from here, so the macros of glCalls.h are left out
+#define GL_CALLS_IMPLEMENTATION
+#include "glCalls.h"
+
+#include <cstring>
+#include <sstream>
+
+// Texture units and capabilities the shadow of the state keeps track of
+#define GL_CALLS_UNITS 32
+#define GL_CALLS_CAPS 16
+#define GL_CALLS_UNKNOWN 0xFFFFFFFF
+
+static const char* s_names[GL_CALL_TOTAL] = {
+    "glActiveTexture", "glBindTexture", "glBindBuffer", "glBindFramebuffer", "glBindRenderbuffer",
+    "glBindVertexArray", "glUseProgram", "glEnable", "glDisable", "glViewport", "glBlendFunc",
+    "glBlendFuncSeparate", "glBlendEquation", "glBlendEquationSeparate", "glClearColor", "glClear", "glUniform", "glGetUniformLocation", "glGetIntegerv", "glGetError",
+    "glVertexAttribPointer", "glEnableVertexAttribArray", "glDisableVertexAttribArray",
+    "glTexParameteri", "glTexImage2D", "glBufferData", "glDrawArrays", "glDrawElements",
+    "glReadPixels"
+};
+
+static unsigned long s_total[GL_CALL_TOTAL];
+static unsigned long s_frame[GL_CALL_TOTAL];
+static unsigned long s_last[GL_CALL_TOTAL];
+static unsigned long s_redundant[GL_CALL_TOTAL];
+static unsigned long s_frames = 0;
+
+// What the calls set the state to. Everything starts unknown, so first calls are never redundant
+struct GlShadow {
+    GLuint  activeUnit = GL_CALLS_UNKNOWN;
+    GLuint  textures[GL_CALLS_UNITS];
+    GLuint  arrayBuffer = GL_CALLS_UNKNOWN;
+    GLuint  elementBuffer = GL_CALLS_UNKNOWN;  // part of the vertex array object
+    GLuint  framebuffer = GL_CALLS_UNKNOWN;
+    GLuint  renderbuffer = GL_CALLS_UNKNOWN;
+    GLuint  vertexArray = GL_CALLS_UNKNOWN;
+    GLuint  program = GL_CALLS_UNKNOWN;
+    GLenum  caps[GL_CALLS_CAPS];
+    int     capStates[GL_CALLS_CAPS];          // 1 enabled, 0 disabled
+    int     capCount = 0;
+    GLint   viewport[4] = { -1, -1, -1, -1 };
+    GLenum  blend[2] = { GL_CALLS_UNKNOWN, GL_CALLS_UNKNOWN };
+    GLenum  blendEquation[2] = { GL_CALLS_UNKNOWN, GL_CALLS_UNKNOWN };  // RGB and alpha
+    GLfloat clearColor[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+
+    GlShadow() {
+        for (int i = 0; i < GL_CALLS_UNITS; i++) {
+            textures[i] = GL_CALLS_UNKNOWN;
+        }
+    }
+};
+static GlShadow s_shadow;
+
+// Count a call to _call, redundant if _same
+static void count(GlCall _call, bool _same = false) {
+    s_total[_call]++;
+    s_frame[_call]++;
+    if (_same) {
+        s_redundant[_call]++;
+    }
+}
+
+// Set _value to _new, true if it already was
+template <class T>
+static bool update(T& _value, T _new) {
+    bool same = _value == _new;
+    _value = _new;
+    return same;
+}
+
+// Capability _cap turned to _state, true if it already was
+static bool updateCap(GLenum _cap, int _state) {
+    for (int i = 0; i < s_shadow.capCount; i++) {
+        if (s_shadow.caps[i] == _cap) {
+            return update(s_shadow.capStates[i], _state);
+        }
+    }
+    if (s_shadow.capCount < GL_CALLS_CAPS) {
+        s_shadow.caps[s_shadow.capCount] = _cap;
+        s_shadow.capStates[s_shadow.capCount] = _state;
+        s_shadow.capCount++;
+    }
+    return false;
+}
+
+// Names of deleted objects are unbound, and can come back for new ones
+static void forget(GLuint& _value, GLsizei _n, const GLuint* _names) {
+    for (GLsizei i = 0; i < _n; i++) {
+        if (_value == _names[i]) {
+            _value = GL_CALLS_UNKNOWN;
+        }
+    }
+}
+
+bool glCallsAvailable() {
+#ifdef GL_CALL_COUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void glCallsNextFrame() {
+    memcpy(s_last, s_frame, sizeof(s_frame));
+    memset(s_frame, 0, sizeof(s_frame));
+    s_frames++;
+}
+
+std::string glCallsReport() {
+    std::stringstream json;
+    json << "{\"frames\":" << s_frames << ",\"calls\":{";
+    bool first = true;
+    for (int i = 0; i < GL_CALL_TOTAL; i++) {
+        if (s_total[i] == 0) {
+            continue;
+        }
+        json << (first? "" : ",") << "\"" << s_names[i] << "\":{";
+        json << "\"total\":" << s_total[i];
+        json << ",\"per_frame\":" << (s_frames > 0? double(s_total[i]) / s_frames : 0.0);
+        json << ",\"last_frame\":" << s_last[i];
+        json << ",\"redundant\":" << s_redundant[i];
+        json << "}";
+        first = false;
+    }
+    json << "}}";
+    return json.str();
+}
+
+void glCountActiveTexture(GLenum _texture) {
+    count(GL_CALL_ACTIVE_TEXTURE, update(s_shadow.activeUnit, (GLuint)(_texture - GL_TEXTURE0)));
+    glActiveTexture(_texture);
+}
+
+void glCountBindTexture(GLenum _target, GLuint _texture) {
+    bool same = false;
+    if (_target == GL_TEXTURE_2D && s_shadow.activeUnit < GL_CALLS_UNITS) {
+        same = update(s_shadow.textures[s_shadow.activeUnit], _texture);
+    }
+    count(GL_CALL_BIND_TEXTURE, same);
+    glBindTexture(_target, _texture);
+}
+
+void glCountBindBuffer(GLenum _target, GLuint _buffer) {
+    bool same = false;
+    if (_target == GL_ARRAY_BUFFER) {
+        same = update(s_shadow.arrayBuffer, _buffer);
+    }
+    else if (_target == GL_ELEMENT_ARRAY_BUFFER) {
+        same = update(s_shadow.elementBuffer, _buffer);
+    }
+    count(GL_CALL_BIND_BUFFER, same);
+    glBindBuffer(_target, _buffer);
+}
+
+void glCountBindFramebuffer(GLenum _target, GLuint _framebuffer) {
+    bool same = false;
+    if (_target == GL_FRAMEBUFFER) {
+        same = update(s_shadow.framebuffer, _framebuffer);
+    }
+    else {
+        // Only one of draw or read, the shadow of both can't tell anymore
+        s_shadow.framebuffer = GL_CALLS_UNKNOWN;
+    }
+    count(GL_CALL_BIND_FRAMEBUFFER, same);
+    glBindFramebuffer(_target, _framebuffer);
+}
+
+void glCountBindRenderbuffer(GLenum _target, GLuint _renderbuffer) {
+    count(GL_CALL_BIND_RENDERBUFFER, update(s_shadow.renderbuffer, _renderbuffer));
+    glBindRenderbuffer(_target, _renderbuffer);
+}
+
+#ifndef PLATFORM_RPI
+void glCountBindVertexArray(GLuint _array) {
+    bool same = update(s_shadow.vertexArray, _array);
+    if (!same) {
+        s_shadow.elementBuffer = GL_CALLS_UNKNOWN;
+    }
+    count(GL_CALL_BIND_VERTEX_ARRAY, same);
+    glBindVertexArray(_array);
+}
+#endif
+
+void glCountUseProgram(GLuint _program) {
+    count(GL_CALL_USE_PROGRAM, update(s_shadow.program, _program));
+    glUseProgram(_program);
+}
+
+void glCountEnable(GLenum _cap) {
+    count(GL_CALL_ENABLE, updateCap(_cap, 1));
+    glEnable(_cap);
+}
+
+void glCountDisable(GLenum _cap) {
+    count(GL_CALL_DISABLE, updateCap(_cap, 0));
+    glDisable(_cap);
+}
+
+void glCountViewport(GLint _x, GLint _y, GLsizei _width, GLsizei _height) {
+    GLint viewport[4] = { _x, _y, _width, _height };
+    bool same = memcmp(s_shadow.viewport, viewport, sizeof(viewport)) == 0;
+    memcpy(s_shadow.viewport, viewport, sizeof(viewport));
+    count(GL_CALL_VIEWPORT, same);
+    glViewport(_x, _y, _width, _height);
+}
+
+void glCountBlendFunc(GLenum _sfactor, GLenum _dfactor) {
+    bool same = s_shadow.blend[0] == _sfactor && s_shadow.blend[1] == _dfactor;
+    s_shadow.blend[0] = _sfactor;
+    s_shadow.blend[1] = _dfactor;
+    count(GL_CALL_BLEND_FUNC, same);
+    glBlendFunc(_sfactor, _dfactor);
+}
+
+void glCountBlendFuncSeparate(GLenum _srcRGB, GLenum _dstRGB, GLenum _srcAlpha, GLenum _dstAlpha) {
+    // The shadow of glBlendFunc can't tell what the factors of each are anymore
+    s_shadow.blend[0] = GL_CALLS_UNKNOWN;
+    s_shadow.blend[1] = GL_CALLS_UNKNOWN;
+    count(GL_CALL_BLEND_FUNC_SEPARATE);
+    glBlendFuncSeparate(_srcRGB, _dstRGB, _srcAlpha, _dstAlpha);
+}
+
+void glCountBlendEquation(GLenum _mode) {
+    bool same = s_shadow.blendEquation[0] == _mode && s_shadow.blendEquation[1] == _mode;
+    s_shadow.blendEquation[0] = _mode;
+    s_shadow.blendEquation[1] = _mode;
+    count(GL_CALL_BLEND_EQUATION, same);
+    glBlendEquation(_mode);
+}
+
+void glCountBlendEquationSeparate(GLenum _modeRGB, GLenum _modeAlpha) {
+    bool same = s_shadow.blendEquation[0] == _modeRGB && s_shadow.blendEquation[1] == _modeAlpha;
+    s_shadow.blendEquation[0] = _modeRGB;
+    s_shadow.blendEquation[1] = _modeAlpha;
+    count(GL_CALL_BLEND_EQUATION_SEPARATE, same);
+    glBlendEquationSeparate(_modeRGB, _modeAlpha);
+}
+
+void glCountClearColor(GLfloat _red, GLfloat _green, GLfloat _blue, GLfloat _alpha) {
+    GLfloat color[4] = { _red, _green, _blue, _alpha };
+    bool same = memcmp(s_shadow.clearColor, color, sizeof(color)) == 0;
+    memcpy(s_shadow.clearColor, color, sizeof(color));
+    count(GL_CALL_CLEAR_COLOR, same);
+    glClearColor(_red, _green, _blue, _alpha);
+}
+
+void glCountClear(GLbitfield _mask) {
+    count(GL_CALL_CLEAR);
+    glClear(_mask);
+}
+
+void glCountUniform1i(GLint _location, GLint _v0) {
+    count(GL_CALL_UNIFORM);
+    glUniform1i(_location, _v0);
+}
+
+void glCountUniform1f(GLint _location, GLfloat _v0) {
+    count(GL_CALL_UNIFORM);
+    glUniform1f(_location, _v0);
+}
+
+void glCountUniform2f(GLint _location, GLfloat _v0, GLfloat _v1) {
+    count(GL_CALL_UNIFORM);
+    glUniform2f(_location, _v0, _v1);
+}
+
+void glCountUniform3f(GLint _location, GLfloat _v0, GLfloat _v1, GLfloat _v2) {
+    count(GL_CALL_UNIFORM);
+    glUniform3f(_location, _v0, _v1, _v2);
+}
+
+void glCountUniform4f(GLint _location, GLfloat _v0, GLfloat _v1, GLfloat _v2, GLfloat _v3) {
+    count(GL_CALL_UNIFORM);
+    glUniform4f(_location, _v0, _v1, _v2, _v3);
+}
+
+void glCountUniformMatrix2fv(GLint _location, GLsizei _count, GLboolean _transpose, const GLfloat* _value) {
+    count(GL_CALL_UNIFORM);
+    glUniformMatrix2fv(_location, _count, _transpose, _value);
+}
+
+void glCountUniformMatrix3fv(GLint _location, GLsizei _count, GLboolean _transpose, const GLfloat* _value) {
+    count(GL_CALL_UNIFORM);
+    glUniformMatrix3fv(_location, _count, _transpose, _value);
+}
+
+void glCountUniformMatrix4fv(GLint _location, GLsizei _count, GLboolean _transpose, const GLfloat* _value) {
+    count(GL_CALL_UNIFORM);
+    glUniformMatrix4fv(_location, _count, _transpose, _value);
+}
+
+GLint glCountGetUniformLocation(GLuint _program, const GLchar* _name) {
+    count(GL_CALL_GET_UNIFORM_LOCATION);
+    return glGetUniformLocation(_program, _name);
+}
+
+void glCountGetIntegerv(GLenum _pname, GLint* _data) {
+    count(GL_CALL_GET_INTEGERV);
+    glGetIntegerv(_pname, _data);
+}
+
+GLenum glCountGetError() {
+    count(GL_CALL_GET_ERROR);
+    return glGetError();
+}
+
+void glCountVertexAttribPointer(GLuint _index, GLint _size, GLenum _type, GLboolean _normalized, GLsizei _stride, const void* _pointer) {
+    count(GL_CALL_VERTEX_ATTRIB_POINTER);
+    glVertexAttribPointer(_index, _size, _type, _normalized, _stride, _pointer);
+}
+
+void glCountEnableVertexAttribArray(GLuint _index) {
+    count(GL_CALL_ENABLE_VERTEX_ATTRIB_ARRAY);
+    glEnableVertexAttribArray(_index);
+}
+
+void glCountDisableVertexAttribArray(GLuint _index) {
+    count(GL_CALL_DISABLE_VERTEX_ATTRIB_ARRAY);
+    glDisableVertexAttribArray(_index);
+}
+
+void glCountTexParameteri(GLenum _target, GLenum _pname, GLint _param) {
+    count(GL_CALL_TEX_PARAMETERI);
+    glTexParameteri(_target, _pname, _param);
+}
+
+void glCountTexImage2D(GLenum _target, GLint _level, GLint _internalformat, GLsizei _width, GLsizei _height, GLint _border, GLenum _format, GLenum _type, const void* _pixels) {
+    count(GL_CALL_TEX_IMAGE_2D);
+    glTexImage2D(_target, _level, _internalformat, _width, _height, _border, _format, _type, _pixels);
+}
+
+void glCountBufferData(GLenum _target, GLsizeiptr _size, const void* _data, GLenum _usage) {
+    count(GL_CALL_BUFFER_DATA);
+    glBufferData(_target, _size, _data, _usage);
+}
+
+void glCountDrawArrays(GLenum _mode, GLint _first, GLsizei _count) {
+    count(GL_CALL_DRAW_ARRAYS);
+    glDrawArrays(_mode, _first, _count);
+}
+
+void glCountDrawElements(GLenum _mode, GLsizei _count, GLenum _type, const void* _indices) {
+    count(GL_CALL_DRAW_ELEMENTS);
+    glDrawElements(_mode, _count, _type, _indices);
+}
+
+void glCountReadPixels(GLint _x, GLint _y, GLsizei _width, GLsizei _height, GLenum _format, GLenum _type, void* _pixels) {
+    count(GL_CALL_READ_PIXELS);
+    glReadPixels(_x, _y, _width, _height, _format, _type, _pixels);
+}
+
+void glCountDeleteTextures(GLsizei _n, const GLuint* _textures) {
+    for (int i = 0; i < GL_CALLS_UNITS; i++) {
+        forget(s_shadow.textures[i], _n, _textures);
+    }
+    glDeleteTextures(_n, _textures);
+}
+
+void glCountDeleteBuffers(GLsizei _n, const GLuint* _buffers) {
+    forget(s_shadow.arrayBuffer, _n, _buffers);
+    forget(s_shadow.elementBuffer, _n, _buffers);
+    glDeleteBuffers(_n, _buffers);
+}
+
+void glCountDeleteFramebuffers(GLsizei _n, const GLuint* _framebuffers) {
+    forget(s_shadow.framebuffer, _n, _framebuffers);
+    glDeleteFramebuffers(_n, _framebuffers);
+}
+
+void glCountDeleteRenderbuffers(GLsizei _n, const GLuint* _renderbuffers) {
+    forget(s_shadow.renderbuffer, _n, _renderbuffers);
+    glDeleteRenderbuffers(_n, _renderbuffers);
+}
+
+void glCountDeleteProgram(GLuint _program) {
+    forget(s_shadow.program, 1, &_program);
+    glDeleteProgram(_program);
+}
+
+#ifndef PLATFORM_RPI
+void glCountDeleteVertexArrays(GLsizei _n, const GLuint* _arrays) {
+    GLuint array = s_shadow.vertexArray;
+    forget(s_shadow.vertexArray, _n, _arrays);
+    if (s_shadow.vertexArray != array) {
+        s_shadow.elementBuffer = GL_CALLS_UNKNOWN;
+    }
+    glDeleteVertexArrays(_n, _arrays);
+}
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+
+#include "gl.h"
+
+//  GL call counting (cmake -DGL_CALL_COUNTING=ON): the GL entry points glslViewer calls are
+//  replaced by macros with glCount* functions that count them, per frame and in total, before
+//  calling them. The ones that set state keep a shadow of it and count the calls that set it to
+//  what it already was. Calls are never skipped, the shadow is only used for the counts.
+//  Without the option there are no macros and nothing is counted
+enum GlCall {
+    GL_CALL_ACTIVE_TEXTURE = 0,
+    GL_CALL_BIND_TEXTURE,
+    GL_CALL_BIND_BUFFER,
+    GL_CALL_BIND_FRAMEBUFFER,
+    GL_CALL_BIND_RENDERBUFFER,
+    GL_CALL_BIND_VERTEX_ARRAY,
+    GL_CALL_USE_PROGRAM,
+    GL_CALL_ENABLE,
+    GL_CALL_DISABLE,
+    GL_CALL_VIEWPORT,
+    GL_CALL_BLEND_FUNC,
+    GL_CALL_BLEND_FUNC_SEPARATE,
+    GL_CALL_BLEND_EQUATION,
+    GL_CALL_BLEND_EQUATION_SEPARATE,
+    GL_CALL_CLEAR_COLOR,
+    GL_CALL_CLEAR,
+    GL_CALL_UNIFORM,            // all of glUniform* and glUniformMatrix*
+    GL_CALL_GET_UNIFORM_LOCATION,
+    GL_CALL_GET_INTEGERV,
+    GL_CALL_GET_ERROR,
+    GL_CALL_VERTEX_ATTRIB_POINTER,
+    GL_CALL_ENABLE_VERTEX_ATTRIB_ARRAY,
+    GL_CALL_DISABLE_VERTEX_ATTRIB_ARRAY,
+    GL_CALL_TEX_PARAMETERI,
+    GL_CALL_TEX_IMAGE_2D,
+    GL_CALL_BUFFER_DATA,
+    GL_CALL_DRAW_ARRAYS,
+    GL_CALL_DRAW_ELEMENTS,
+    GL_CALL_READ_PIXELS,
+    GL_CALL_TOTAL
+};
+
+//  True when built with GL_CALL_COUNTING
+bool    glCallsAvailable();
+
+//  The calls since the last one are a frame
+void    glCallsNextFrame();
+
+//  {"frames":N,"calls":{"<function>":{"total":..,"per_frame":..,"last_frame":..,"redundant":..}}}
+//  Functions that weren't called are left out
+std::string glCallsReport();
+
+#if defined(GL_CALL_COUNTING) && !defined(GL_CALLS_IMPLEMENTATION)
+
+void    glCountActiveTexture(GLenum _texture);
+void    glCountBindTexture(GLenum _target, GLuint _texture);
+void    glCountBindBuffer(GLenum _target, GLuint _buffer);
+void    glCountBindFramebuffer(GLenum _target, GLuint _framebuffer);
+void    glCountBindRenderbuffer(GLenum _target, GLuint _renderbuffer);
+#ifndef PLATFORM_RPI
+void    glCountBindVertexArray(GLuint _array);
+#endif
+void    glCountUseProgram(GLuint _program);
+void    glCountEnable(GLenum _cap);
+void    glCountDisable(GLenum _cap);
+void    glCountViewport(GLint _x, GLint _y, GLsizei _width, GLsizei _height);
+void    glCountBlendFunc(GLenum _sfactor, GLenum _dfactor);
+void    glCountBlendFuncSeparate(GLenum _srcRGB, GLenum _dstRGB, GLenum _srcAlpha, GLenum _dstAlpha);
+void    glCountBlendEquation(GLenum _mode);
+void    glCountBlendEquationSeparate(GLenum _modeRGB, GLenum _modeAlpha);
+void    glCountClearColor(GLfloat _red, GLfloat _green, GLfloat _blue, GLfloat _alpha);
+void    glCountClear(GLbitfield _mask);
+void    glCountUniform1i(GLint _location, GLint _v0);
+void    glCountUniform1f(GLint _location, GLfloat _v0);
+void    glCountUniform2f(GLint _location, GLfloat _v0, GLfloat _v1);
+void    glCountUniform3f(GLint _location, GLfloat _v0, GLfloat _v1, GLfloat _v2);
+void    glCountUniform4f(GLint _location, GLfloat _v0, GLfloat _v1, GLfloat _v2, GLfloat _v3);
+void    glCountUniformMatrix2fv(GLint _location, GLsizei _count, GLboolean _transpose, const GLfloat* _value);
+void    glCountUniformMatrix3fv(GLint _location, GLsizei _count, GLboolean _transpose, const GLfloat* _value);
+void    glCountUniformMatrix4fv(GLint _location, GLsizei _count, GLboolean _transpose, const GLfloat* _value);
+GLint   glCountGetUniformLocation(GLuint _program, const GLchar* _name);
+void    glCountGetIntegerv(GLenum _pname, GLint* _data);
+GLenum  glCountGetError();
+void    glCountVertexAttribPointer(GLuint _index, GLint _size, GLenum _type, GLboolean _normalized, GLsizei _stride, const void* _pointer);
+void    glCountEnableVertexAttribArray(GLuint _index);
+void    glCountDisableVertexAttribArray(GLuint _index);
+void    glCountTexParameteri(GLenum _target, GLenum _pname, GLint _param);
+void    glCountTexImage2D(GLenum _target, GLint _level, GLint _internalformat, GLsizei _width, GLsizei _height, GLint _border, GLenum _format, GLenum _type, const void* _pixels);
+void    glCountBufferData(GLenum _target, GLsizeiptr _size, const void* _data, GLenum _usage);
+void    glCountDrawArrays(GLenum _mode, GLint _first, GLsizei _count);
+void    glCountDrawElements(GLenum _mode, GLsizei _count, GLenum _type, const void* _indices);
+void    glCountReadPixels(GLint _x, GLint _y, GLsizei _width, GLsizei _height, GLenum _format, GLenum _type, void* _pixels);
+//  Deleted objects can't be bound anymore, and their names can be given again
+void    glCountDeleteTextures(GLsizei _n, const GLuint* _textures);
+void    glCountDeleteBuffers(GLsizei _n, const GLuint* _buffers);
+void    glCountDeleteFramebuffers(GLsizei _n, const GLuint* _framebuffers);
+void    glCountDeleteRenderbuffers(GLsizei _n, const GLuint* _renderbuffers);
+void    glCountDeleteProgram(GLuint _program);
+#ifndef PLATFORM_RPI
+void    glCountDeleteVertexArrays(GLsizei _n, const GLuint* _arrays);
+#endif
+
+#define glActiveTexture glCountActiveTexture
+#define glBindTexture glCountBindTexture
+#define glBindBuffer glCountBindBuffer
+#define glBindFramebuffer glCountBindFramebuffer
+#define glBindRenderbuffer glCountBindRenderbuffer
+#ifndef PLATFORM_RPI
+#define glBindVertexArray glCountBindVertexArray
+#endif
+#define glUseProgram glCountUseProgram
+#define glEnable glCountEnable
+#define glDisable glCountDisable
+#define glViewport glCountViewport
+#define glBlendFunc glCountBlendFunc
+#define glBlendFuncSeparate glCountBlendFuncSeparate
+#define glBlendEquation glCountBlendEquation
+#define glBlendEquationSeparate glCountBlendEquationSeparate
+#define glClearColor glCountClearColor
+#define glClear glCountClear
+#define glUniform1i glCountUniform1i
+#define glUniform1f glCountUniform1f
+#define glUniform2f glCountUniform2f
+#define glUniform3f glCountUniform3f
+#define glUniform4f glCountUniform4f
+#define glUniformMatrix2fv glCountUniformMatrix2fv
+#define glUniformMatrix3fv glCountUniformMatrix3fv
+#define glUniformMatrix4fv glCountUniformMatrix4fv
+#define glGetUniformLocation glCountGetUniformLocation
+#define glGetIntegerv glCountGetIntegerv
+#define glGetError glCountGetError
+#define glVertexAttribPointer glCountVertexAttribPointer
+#define glEnableVertexAttribArray glCountEnableVertexAttribArray
+#define glDisableVertexAttribArray glCountDisableVertexAttribArray
+#define glTexParameteri glCountTexParameteri
+#define glTexImage2D glCountTexImage2D
+#define glBufferData glCountBufferData
+#define glDrawArrays glCountDrawArrays
+#define glDrawElements glCountDrawElements
+#define glReadPixels glCountReadPixels
+#define glDeleteTextures glCountDeleteTextures
+#define glDeleteBuffers glCountDeleteBuffers
+#define glDeleteFramebuffers glCountDeleteFramebuffers
+#define glDeleteRenderbuffers glCountDeleteRenderbuffers
+#define glDeleteProgram glCountDeleteProgram
+#ifndef PLATFORM_RPI
+#define glDeleteVertexArrays glCountDeleteVertexArrays
+#endif
+
+#endif
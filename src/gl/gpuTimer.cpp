@@ -0,0 +1,106 @@
+#include "gpuTimer.h"
+
+#include <cstdio>
+#include <cstring>
+
+GpuTimer::GpuTimer(): m_first(0), m_count(0), m_running(false) {
+    memset(m_queries, 0, sizeof(m_queries));
+}
+
+GpuTimer::~GpuTimer() {
+#ifdef PLATFORM_LINUX
+    if (m_queries[0] != 0) {
+        glDeleteQueries(GPU_TIMER_QUERIES, m_queries);
+    }
+#endif
+}
+
+bool GpuTimer::isSupported() {
+#ifdef PLATFORM_LINUX
+    static int supported = -1;
+    if (supported == -1) {
+        int major = 0, minor = 0;
+        const char* version = (const char*)glGetString(GL_VERSION);
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        if (version != nullptr) {
+            sscanf(version, "%d.%d", &major, &minor);
+        }
+        supported = (major * 10 + minor >= 33 || (extensions != nullptr && strstr(extensions, "GL_ARB_timer_query") != nullptr))? 1 : 0;
+
+        // Software rasterizers (llvmpipe, softpipe, SwiftShader) draw when the commands are
+        // flushed, after the query ends, so their queries only measure the submission
+        if (renderer != nullptr && (strstr(renderer, "llvmpipe") != nullptr || strstr(renderer, "softpipe") != nullptr || strstr(renderer, "SwiftShader") != nullptr)) {
+            supported = 0;
+        }
+    }
+    return supported == 1;
+#else
+    // Neither OpenGL ES 2.0 nor the legacy macOS context have them
+    return false;
+#endif
+}
+
+void GpuTimer::begin() {
+#ifdef PLATFORM_LINUX
+    if (m_running || !isSupported()) {
+        return;
+    }
+
+    if (m_queries[0] == 0) {
+        glGenQueries(GPU_TIMER_QUERIES, m_queries);
+    }
+
+    // Too many frames in flight, forget the oldest
+    if (m_count == GPU_TIMER_QUERIES) {
+        m_first = (m_first + 1) % GPU_TIMER_QUERIES;
+        m_count--;
+    }
+
+    int next = (m_first + m_count) % GPU_TIMER_QUERIES;
+    m_begins[next] = std::chrono::steady_clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[next]);
+    m_running = true;
+#endif
+}
+
+void GpuTimer::end() {
+#ifdef PLATFORM_LINUX
+    if (!m_running) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_count++;
+    m_running = false;
+#endif
+}
+
+bool GpuTimer::getResult(double& _milliseconds) {
+    std::chrono::steady_clock::time_point begin;
+    return getResult(_milliseconds, begin);
+}
+
+bool GpuTimer::getResult(double& _milliseconds, std::chrono::steady_clock::time_point& _begin) {
+    bool found = false;
+#ifdef PLATFORM_LINUX
+    while (m_count > 0) {
+        GLuint query = m_queries[m_first];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        _milliseconds = elapsed * 1e-6;
+        _begin = m_begins[m_first];
+        found = true;
+
+        m_first = (m_first + 1) % GPU_TIMER_QUERIES;
+        m_count--;
+    }
+#endif
+    return found;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+
+#include "gl.h"
+
+//  Frames that can be in flight before a result is read (and the oldest one dropped)
+#define GPU_TIMER_QUERIES 4
+
+//  Measures how long the GPU takes to run the commands between begin() and end() with
+//  GL_TIME_ELAPSED queries. Results arrive some frames later and are collected without
+//  waiting for them. Timers can't be nested.
+class GpuTimer {
+public:
+    GpuTimer();
+    virtual ~GpuTimer();
+
+    //  Timer queries are available (OpenGL 3.3 or ARB_timer_query) and meaningful (not a software rasterizer)
+    static bool isSupported();
+
+    void    begin();
+    void    end();
+
+    //  Milliseconds of the newest measure that has arrived since the last call, false if none did
+    bool    getResult(double& _milliseconds);
+
+    //  Same, and when the CPU began the measured commands, to place them on a timeline
+    bool    getResult(double& _milliseconds, std::chrono::steady_clock::time_point& _begin);
+
+private:
+    GLuint  m_queries[GPU_TIMER_QUERIES];
+    std::chrono::steady_clock::time_point m_begins[GPU_TIMER_QUERIES];
+    int     m_first;    // oldest query waiting for its result
+    int     m_count;    // queries waiting for their result
+    bool    m_running;
+};
@@ -1,19 +1,17 @@
 #include "pingpong.h"
 #include <iostream>
 
-PingPong::PingPong() {
+PingPong::PingPong(): src(nullptr), dst(nullptr), m_flag(0) {
 }
 
 PingPong::~PingPong() {
 }
 
-void PingPong::allocate(int _width, int _height, bool _depth) {
+void PingPong::allocate(int _width, int _height, bool _depth, FboFormat _format) {
     for(int i = 0; i < 2; i++){
-        m_fbos[i].allocate(_width, _height, _depth);
+        m_fbos[i].allocate(_width, _height, _depth, _format);
     }
 
-    clear();
-
     // Set everything to 0
     m_flag = 0;
     swap();
@@ -26,7 +24,7 @@ void PingPong::swap(){
 
 void PingPong::clear(float _alpha) {
     for(int i = 0; i < 2; i++){
-        m_fbos[i].bind();
+        m_fbos[i].bind(FBO_LOAD_PRESERVE);
         glClearColor(0.0f, 0.0f, 0.0f, _alpha);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         m_fbos[i].unbind();
@@ -0,0 +1,240 @@
+#include "renderGraph.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#include "tools/text.h"
+
+BufferOptions getBufferOptions(const std::string& _fragmentSrc, const std::string& _name, const BufferOptions& _default) {
+    BufferOptions options = _default;
+
+    std::istringstream lines(_fragmentSrc);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word) || word != "#pragma" || !(words >> word) || word != "buffer" || !(words >> word) || word != _name) {
+            continue;
+        }
+
+        while (words >> word) {
+            if (isdigit(word[0]) || word[0] == '.') {
+                float scale = toFloat(word);
+                if (scale > 0.0 && scale <= 1.0) {
+                    options.scale = scale;
+                }
+                else {
+                    std::cerr << "The scale of " << _name << " has to be in (0,1], not " << word << std::endl;
+                }
+            }
+            else if (!Fbo::parseFormat(word, options.format) && !Fbo::parseLoad(word, options.load)) {
+                std::cerr << "Unknown option " << word << " for " << _name << std::endl;
+            }
+        }
+    }
+
+    return options;
+}
+
+RenderPass::RenderPass(): pingPong(false), m_width(0), m_height(0), m_format(FBO_RGBA8), m_allocatedPingPong(false) {
+}
+
+RenderPass::~RenderPass() {
+}
+
+void RenderPass::allocate(int _width, int _height) {
+    int width = options.getScaled(_width);
+    int height = options.getScaled(_height);
+    if (width == m_width && height == m_height && options.format == m_format && pingPong == m_allocatedPingPong) {
+        return;
+    }
+
+    if (pingPong) {
+        m_pingpong.allocate(width, height, false, options.format);
+    }
+    else {
+        m_fbo.allocate(width, height, false, options.format);
+    }
+
+    m_width = width;
+    m_height = height;
+    m_format = options.format;
+    m_allocatedPingPong = pingPong;
+}
+
+void RenderPass::bind() {
+    if (pingPong) {
+        m_pingpong.swap();
+        m_pingpong.src->bind(options.load);
+    }
+    else {
+        m_fbo.bind(options.load);
+    }
+}
+
+void RenderPass::unbind() {
+    if (pingPong) {
+        m_pingpong.src->unbind();
+    }
+    else {
+        m_fbo.unbind();
+    }
+}
+
+const Fbo* RenderPass::getResult() const {
+    return pingPong? m_pingpong.src : &m_fbo;
+}
+
+const Fbo* RenderPass::getPrevious() const {
+    return pingPong? m_pingpong.dst : &m_fbo;
+}
+
+RenderGraph::RenderGraph(): m_width(0), m_height(0) {
+}
+
+RenderGraph::~RenderGraph() {
+    clear();
+}
+
+int RenderGraph::countBuffers(const std::string& _fragmentSrc) {
+    int count = 0;
+    std::string token = "BUFFER_";
+    for (size_t pos = _fragmentSrc.find(token); pos != std::string::npos; pos = _fragmentSrc.find(token, pos + 1)) {
+        size_t end = pos + token.size();
+        if (end < _fragmentSrc.size() && isdigit(_fragmentSrc[end])) {
+            int n = atoi(_fragmentSrc.c_str() + end);
+            if (n + 1 > count) {
+                count = n + 1;
+            }
+        }
+    }
+    return count;
+}
+
+bool RenderGraph::load(const std::string& _fragmentSrc, const std::string& _vertexSrc, const std::vector<std::string>& _defines, bool _verbose) {
+    int count = countBuffers(_fragmentSrc);
+
+    // Keep the passes that already exist so their buffers survive a reload
+    while ((int)m_passes.size() > count) {
+        delete m_passes.back();
+        m_passes.pop_back();
+    }
+    while ((int)m_passes.size() < count) {
+        m_passes.push_back(new RenderPass());
+    }
+
+    m_names.resize(count);
+    bool success = true;
+    for (int i = 0; i < count; i++) {
+        m_names[i] = "u_buffer" + toString(i);
+        m_passes[i]->options = getBufferOptions(_fragmentSrc, m_names[i], m_defaults);
+
+        std::vector<std::string> defines = _defines;
+        defines.push_back("BUFFER_" + toString(i));
+
+        m_passes[i]->shader.detach(GL_FRAGMENT_SHADER | GL_VERTEX_SHADER);
+        if (!m_passes[i]->shader.load(_fragmentSrc, _vertexSrc, defines, _verbose)) {
+            std::cerr << "Error loading the pass for " << m_names[i] << std::endl;
+            success = false;
+        }
+    }
+
+    // What each pass samples is what survived its preprocessor
+    for (int i = 0; i < count; i++) {
+        m_passes[i]->reads.clear();
+        for (int j = 0; j < count; j++) {
+            if (m_passes[i]->shader.hasUniform(m_names[j])) {
+                m_passes[i]->reads.push_back(j);
+            }
+        }
+    }
+
+    schedule();
+
+    if (m_width > 0 && m_height > 0) {
+        allocate(m_width, m_height);
+    }
+
+    return success;
+}
+
+void RenderGraph::schedule() {
+    int count = m_passes.size();
+
+    // Depth first, dependencies before the passes that read them. An edge back into
+    // the current path is a cycle, the reader gets the previous frame of that buffer.
+    std::vector<int> state(count, 0);   // 0 not visited, 1 in the current path, 2 scheduled
+    m_order.clear();
+
+    std::function<void(int)> visit = [&](int _n) {
+        state[_n] = 1;
+        for (size_t r = 0; r < m_passes[_n]->reads.size(); r++) {
+            int m = m_passes[_n]->reads[r];
+            if (state[m] == 0) {
+                visit(m);
+            }
+        }
+        state[_n] = 2;
+        m_order.push_back(_n);
+    };
+
+    for (int i = 0; i < count; i++) {
+        if (state[i] == 0) {
+            visit(i);
+        }
+    }
+
+    std::vector<int> position(count);
+    for (int i = 0; i < count; i++) {
+        position[ m_order[i] ] = i;
+    }
+
+    for (int n = 0; n < count; n++) {
+        m_passes[n]->pingPong = false;
+        for (int r = 0; r < count; r++) {
+            for (size_t i = 0; i < m_passes[r]->reads.size(); i++) {
+                if (m_passes[r]->reads[i] == n && position[r] <= position[n]) {
+                    m_passes[n]->pingPong = true;
+                }
+            }
+        }
+    }
+}
+
+void RenderGraph::allocate(int _width, int _height) {
+    m_width = _width;
+    m_height = _height;
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        m_passes[i]->allocate(_width, _height);
+    }
+}
+
+void RenderGraph::clear() {
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        delete m_passes[i];
+    }
+    m_passes.clear();
+    m_names.clear();
+    m_order.clear();
+}
+
+bool RenderGraph::isAnimated() const {
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        if (m_passes[i]->pingPong || m_passes[i]->options.load == FBO_LOAD_PRESERVE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderGraph::setUniforms(Shader& _shader, int _self, unsigned int& _texLoc) const {
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        if (_shader.hasUniform(m_names[i])) {
+            const Fbo* fbo = ((int)i == _self)? m_passes[i]->getPrevious() : m_passes[i]->getResult();
+            _shader.setUniform(m_names[i].c_str(), fbo, _texLoc++);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "shader.h"
+#include "pingpong.h"
+
+//  Color format, resolution (relative to the viewport) and load action of an offscreen buffer
+struct BufferOptions {
+    BufferOptions(): format(FBO_RGBA8), scale(1.0), load(FBO_LOAD_CLEAR) {};
+
+    int getScaled(int _size) const { int size = _size * scale + 0.5; return (size > 0)? size : 1; };
+
+    FboFormat   format;
+    float       scale;
+    FboLoad     load;
+};
+
+//  Options of the buffer _name set in _fragmentSrc by `#pragma buffer <name> [<format>] [<scale>] [<load>]`
+//  (format one of RGBA8, RGBA16F, RGBA32F or R32F; load one of clear, dont_care or preserve), on top of _default
+BufferOptions getBufferOptions(const std::string& _fragmentSrc, const std::string& _name, const BufferOptions& _default);
+
+//  Offscreen pass of a RenderGraph, renders the fragment shader with BUFFER_N defined
+class RenderPass {
+public:
+    RenderPass();
+    virtual ~RenderPass();
+
+    //  Allocate the buffer for a _width x _height viewport, scaled by options
+    void    allocate(int _width, int _height);
+
+    int     getWidth() const { return m_width; };
+    int     getHeight() const { return m_height; };
+
+    //  Bind the buffer this pass renders to (swapping them first if it ping-pongs)
+    void    bind();
+    void    unbind();
+
+    //  Last thing rendered by this pass
+    const Fbo*  getResult() const;
+    //  What it rendered the frame before (same as getResult() unless it ping-pongs)
+    const Fbo*  getPrevious() const;
+
+    Shader  shader;
+    BufferOptions options;
+    std::vector<int> reads;     // buffers sampled by this pass
+    bool    pingPong;           // some pass reads this buffer before it is rendered in the frame
+
+private:
+    PingPong    m_pingpong;
+    Fbo         m_fbo;
+
+    int     m_width;
+    int     m_height;
+    FboFormat m_format;
+    bool    m_allocatedPingPong;
+};
+
+//  Multi-pass rendering from a single fragment shader. Every `#ifdef BUFFER_N` in the source
+//  adds a pass that renders the same source, with BUFFER_N defined, into a buffer that every
+//  pass (including the main one) can sample as `uniform sampler2D u_bufferN`, in the format
+//  and resolution given by `#pragma buffer u_bufferN`.
+//  Passes are rendered in dependency order; only buffers sampled before they are rendered in a
+//  frame (by themselves or through a cycle) are double buffered, and those passes see the
+//  previous frame.
+class RenderGraph {
+public:
+    RenderGraph();
+    virtual ~RenderGraph();
+
+    //  Number of BUFFER_N passes declared in _fragmentSrc
+    static int  countBuffers(const std::string& _fragmentSrc);
+
+    //  Compile a pass per buffer declared in _fragmentSrc and schedule them
+    bool    load(const std::string& _fragmentSrc, const std::string& _vertexSrc, const std::vector<std::string>& _defines, bool _verbose = false);
+    void    allocate(int _width, int _height);
+
+    //  Options of the buffers without a `#pragma buffer`
+    void    setDefaultOptions(const BufferOptions& _options) { m_defaults = _options; };
+    void    clear();
+
+    int     size() const { return m_passes.size(); };
+    RenderPass* operator[](int _n) { return m_passes[_n]; };
+
+    //  Indices of the passes in the order they have to be rendered
+    const std::vector<int>& getOrder() const { return m_order; };
+
+    //  Some pass carries what it rendered from one frame to the next (it ping-pongs or preserves
+    //  its buffer), so the buffers can keep changing even when their inputs don't
+    bool    isAnimated() const;
+
+    //  Bind the buffers sampled by _shader as u_bufferN from texture unit _texLoc on (which is advanced).
+    //  _self is the pass _shader renders (-1 for the main one), which samples its own previous frame.
+    void    setUniforms(Shader& _shader, int _self, unsigned int& _texLoc) const;
+
+private:
+    void    schedule();
+
+    std::vector<RenderPass*>    m_passes;
+    std::vector<std::string>    m_names;
+    std::vector<int>            m_order;
+    BufferOptions               m_defaults;
+
+    int     m_width;
+    int     m_height;
+};
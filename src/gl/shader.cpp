@@ -1,6 +1,9 @@
 #include "shader.h"
+#include "counters.h"
 
 #include "tools/text.h"
+#include "tools/trace.h"
+#include <cctype>
 #include <cstring>
 #include <chrono>
 #include <algorithm>
@@ -45,9 +48,215 @@ bool find_id(const std::string& program, const char* id) {
     return std::strstr(program.c_str(), id) != 0;
 }
 
+std::string getDefineLine(const std::string& _define) {
+    std::string define = _define;
+    size_t equal = define.find('=');
+    if (equal != std::string::npos) {
+        define[equal] = ' ';
+    }
+    return "#define " + define + "\n";
+}
+
+// The first character at or after _pos that isn't blank or in a comment, npos if there is none
+size_t skipBlanks(const std::string& _src, size_t _pos) {
+    while (_pos < _src.size()) {
+        if (isspace(_src[_pos])) {
+            _pos++;
+        }
+        else if (_src.compare(_pos, 2, "//") == 0) {
+            _pos = _src.find('\n', _pos);
+        }
+        else if (_src.compare(_pos, 2, "/*") == 0) {
+            _pos = _src.find("*/", _pos + 2);
+            _pos = (_pos == std::string::npos)? _pos : _pos + 2;
+        }
+        else {
+            return _pos;
+        }
+    }
+    return std::string::npos;
+}
+
+// The identifier that starts at _pos, empty if there is none
+std::string getWord(const std::string& _src, size_t _pos) {
+    size_t end = _pos;
+    while (end < _src.size() && (isalnum(_src[end]) || _src[end] == '_')) {
+        end++;
+    }
+    return (_pos < end && !isdigit(_src[_pos]))? _src.substr(_pos, end - _pos) : "";
+}
+
+// The parenthesis or brace that closes the one at _open, out of comments, npos if there is none
+size_t findClosing(const std::string& _src, size_t _open) {
+    char open = _src[_open];
+    char close = (open == '(')? ')' : '}';
+    int depth = 0;
+    for (size_t i = _open; i < _src.size(); i++) {
+        if (_src.compare(i, 2, "//") == 0) {
+            i = _src.find('\n', i);
+            if (i == std::string::npos) {
+                break;
+            }
+        }
+        else if (_src.compare(i, 2, "/*") == 0) {
+            i = _src.find("*/", i + 2);
+            if (i == std::string::npos) {
+                break;
+            }
+            i++;
+        }
+        else if (_src[i] == open) {
+            depth++;
+        }
+        else if (_src[i] == close && --depth == 0) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+// Where the statement that starts at _start ends (after its ; or }), npos if it can't be told.
+// Loops and ifs end with the statement they run, blocks with their brace
+size_t findStatementEnd(const std::string& _src, size_t _start) {
+    size_t pos = skipBlanks(_src, _start);
+    if (pos == std::string::npos) {
+        return pos;
+    }
+    if (_src[pos] == '{') {
+        size_t close = findClosing(_src, pos);
+        return (close == std::string::npos)? close : close + 1;
+    }
+
+    std::string word = getWord(_src, pos);
+    if (word == "for" || word == "while" || word == "if") {
+        size_t open = skipBlanks(_src, pos + word.size());
+        if (open == std::string::npos || _src[open] != '(') {
+            return std::string::npos;
+        }
+        size_t close = findClosing(_src, open);
+        if (close == std::string::npos) {
+            return close;
+        }
+        size_t end = findStatementEnd(_src, close + 1);
+        if (word == "if" && end != std::string::npos) {
+            size_t next = skipBlanks(_src, end);
+            if (next != std::string::npos && getWord(_src, next) == "else") {
+                end = findStatementEnd(_src, next + 4);
+            }
+        }
+        return end;
+    }
+    if (word == "do") {
+        pos = findStatementEnd(_src, pos + word.size());
+        pos = (pos == std::string::npos)? pos : skipBlanks(_src, pos);
+        if (pos == std::string::npos || getWord(_src, pos) != "while") {
+            return std::string::npos;
+        }
+    }
+
+    // Anything else, and the while of a do, ends at the first ; out of parentheses
+    int depth = 0;
+    for (size_t i = pos; i < _src.size(); i++) {
+        if (_src.compare(i, 2, "//") == 0 || _src.compare(i, 2, "/*") == 0) {
+            i = skipBlanks(_src, i);
+            if (i == std::string::npos) {
+                break;
+            }
+            i--;
+        }
+        else if (_src[i] == '(') {
+            depth++;
+        }
+        else if (_src[i] == ')') {
+            depth--;
+        }
+        else if (_src[i] == ';' && depth == 0) {
+            return i + 1;
+        }
+        else if (_src[i] == '{' || _src[i] == '}') {
+            break;
+        }
+    }
+    return std::string::npos;
+}
+
+// Add _count (an expression) to every iteration of the for, while and do loops of _src, at the
+// start of their body. Bodies without braces get them, as expressions can't go in the loop
+// expression of GLSL ES 1.00. Nothing is added in comments and no lines are added, so errors
+// keep their line numbers
+std::string countLoops(const std::string& _src, const std::string& _count) {
+    std::string out;
+    out.reserve(_src.size() + _src.size() / 4);
+
+    size_t i = 0;
+    while (i < _src.size()) {
+        if (_src.compare(i, 2, "//") == 0 || _src.compare(i, 2, "/*") == 0) {
+            size_t end = (_src[i + 1] == '/')? _src.find('\n', i) : _src.find("*/", i + 2);
+            end = (end == std::string::npos)? _src.size() : end + ((_src[i + 1] == '/')? 0 : 2);
+            out.append(_src, i, end - i);
+            i = end;
+            continue;
+        }
+
+        if (!isalpha(_src[i]) && _src[i] != '_') {
+            out += _src[i++];
+            continue;
+        }
+
+        size_t end = i;
+        while (end < _src.size() && (isalnum(_src[end]) || _src[end] == '_')) {
+            end++;
+        }
+        std::string word = _src.substr(i, end - i);
+        out += word;
+        i = end;
+
+        size_t open = _src.find_first_not_of(" \t\r\n", i);
+        if (open == std::string::npos) {
+            continue;
+        }
+
+        size_t body = std::string::npos;
+        if (word == "do") {
+            body = open;
+        }
+        else if ((word == "for" || word == "while") && _src[open] == '(') {
+            size_t close = findClosing(_src, open);
+            if (close == std::string::npos) {
+                continue;
+            }
+            body = _src.find_first_not_of(" \t\r\n", close + 1);
+            // The while of a do loop was counted at its start
+            if (word == "while" && body != std::string::npos && _src[body] == ';') {
+                body = std::string::npos;
+            }
+        }
+        if (body == std::string::npos) {
+            continue;
+        }
+
+        if (_src[body] == '{') {
+            out.append(_src, i, body + 1 - i);
+            out += _count + ";";
+            i = body + 1;
+        }
+        else {
+            size_t bodyEnd = findStatementEnd(_src, body);
+            if (bodyEnd != std::string::npos) {
+                out.append(_src, i, body - i);
+                out += "{" + _count + ";" + countLoops(_src.substr(body, bodyEnd - body), _count) + "}";
+                i = bodyEnd;
+            }
+        }
+    }
+    return out;
+}
+
 bool Shader::load(const std::string& _fragmentSrc, const std::string& _vertexSrc, const std::vector<std::string> &_defines, bool _verbose) {
-    std::chrono::time_point<std::chrono::steady_clock> start_time, end_time;
+    TRACE_ZONE("Shader::load");
+    std::chrono::time_point<std::chrono::steady_clock> start_time, link_time, end_time;
     start_time = std::chrono::steady_clock::now();
+    m_stats = ShaderStats();
 
     m_vertexShader = compileShader(_vertexSrc, _defines, GL_VERTEX_SHADER);
 
@@ -74,18 +283,22 @@ bool Shader::load(const std::string& _fragmentSrc, const std::string& _vertexSrc
             || find_id(_fragmentSrc, "u_up3d"));
     }
 
+    link_time = std::chrono::steady_clock::now();
     m_program = glCreateProgram();
 
     glAttachShader(m_program, m_vertexShader);
     glAttachShader(m_program, m_fragmentShader);
     glLinkProgram(m_program);
 
-    end_time = std::chrono::steady_clock::now();
-    std::chrono::duration<double> load_time = end_time - start_time;
-
+    // Drivers may link in the background, asking for the status waits for it
     GLint isLinked;
     glGetProgramiv(m_program, GL_LINK_STATUS, &isLinked);
 
+    end_time = std::chrono::steady_clock::now();
+    std::chrono::duration<double> load_time = end_time - start_time;
+    m_stats.compileTime = std::chrono::duration<double, std::milli>(link_time - start_time).count();
+    m_stats.linkTime = std::chrono::duration<double, std::milli>(end_time - link_time).count();
+
     if (isLinked == GL_FALSE) {
         GLint infoLength = 0;
         glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &infoLength);
@@ -107,24 +320,55 @@ bool Shader::load(const std::string& _fragmentSrc, const std::string& _vertexSrc
         glDeleteShader(m_vertexShader);
         glDeleteShader(m_fragmentShader);
 
+        queryStats();
+
         if (_verbose) {
             std::cerr << "shader load time: " << load_time.count() << "s";
+            if (m_stats.binarySize > 0)
+                std::cerr << " size: " << m_stats.binarySize;
+            if (m_stats.instructions > 0)
+                std::cerr << " #instructions: " << m_stats.instructions;
+            std::cerr << std::endl;
+        }
+
+        return true;
+    }
+}
+
+void Shader::queryStats() {
+    // Only some drivers answer these, the ones that don't raise an error that is cleared
 #ifdef GL_PROGRAM_BINARY_LENGTH
-            GLint proglen = 0;
-            glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &proglen);
-            if (proglen > 0)
-                std::cerr << " size: " << proglen;
+    GLint proglen = 0;
+    glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &proglen);
+    if (proglen > 0)
+        m_stats.binarySize = proglen;
 #endif
 #ifdef GL_PROGRAM_INSTRUCTIONS_ARB
-            GLint icount = 0;
-            glGetProgramiv(m_program, GL_PROGRAM_INSTRUCTIONS_ARB, &icount);
-            if (icount > 0)
-                std::cerr << " #instructions: " << icount;
+    GLint icount = 0;
+    glGetProgramiv(m_program, GL_PROGRAM_INSTRUCTIONS_ARB, &icount);
+    if (icount > 0)
+        m_stats.instructions = icount;
 #endif
-            std::cerr << std::endl;
+#ifdef GL_PROGRAM_TEX_INSTRUCTIONS_ARB
+    GLint tcount = 0;
+    glGetProgramiv(m_program, GL_PROGRAM_TEX_INSTRUCTIONS_ARB, &tcount);
+    if (tcount > 0)
+        m_stats.textureFetches = tcount;
+#endif
+    while (glGetError() != GL_NO_ERROR) {}
+
+    // Same active uniforms the inspector lists, asked in a way OpenGL ES 2.0 also has
+    GLint count = 0;
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+    m_stats.uniforms = count;
+    for (GLint i = 0; i < count; i++) {
+        GLchar name[256];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_program, i, sizeof(name), NULL, &size, &type, name);
+        if (type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE) {
+            m_stats.samplers++;
         }
-
-        return true;
     }
 }
 
@@ -146,10 +390,12 @@ bool Shader::isInUse() const {
 
 GLuint Shader::compileShader(const std::string& _src, const std::vector<std::string> &_defines, GLenum _type) {
     std::string prolog = "";
-    const char* epilog = "";
+    std::string epilog = "";
+    const std::string* src = &_src;
+    std::string instrumented;
 
     for (unsigned int i = 0; i < _defines.size(); i++) {
-        prolog += "#define " + _defines[i] + "\n";
+        prolog += getDefineLine(_defines[i]);
     }
 
     // Test if this is a shadertoy.com image shader. If it is, we need to
@@ -194,12 +440,42 @@ GLuint Shader::compileShader(const std::string& _src, const std::vector<std::str
             "}\n";
     }
 
+    // Heatmap: the iterations of every loop are counted and shown over the color, or (with
+    // u_heatmapRaw) written as a 16 bit integer in red and green to be read back. The main
+    // function of the shader is renamed so the one of the epilog can run it first
+    if (_type == GL_FRAGMENT_SHADER && std::find(_defines.begin(), _defines.end(), SHADER_HEATMAP_DEFINE) != _defines.end()) {
+        prolog +=
+            "float heatmapCost = 0.0;\n"
+            "#define HEATMAP_COST(n) heatmapCost += float(n)\n"
+            "#define main heatmapMain\n"
+            "\n";
+        instrumented = countLoops(_src, "heatmapCost += 1.0");
+        src = &instrumented;
+        epilog +=
+            "\n"
+            "#undef main\n"
+            "uniform float u_heatmapMax;\n"
+            "uniform int u_heatmapRaw;\n"
+            "void main(void) {\n"
+            "    heatmapMain();\n"
+            "    float t = clamp(heatmapCost / u_heatmapMax, 0.0, 1.0);\n"
+            "    vec3 heat = clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);\n"
+            "    float cost = min(heatmapCost, 65535.0);\n"
+            "    if (u_heatmapRaw == 1) {\n"
+            "        gl_FragColor = vec4(mod(cost, 256.0) / 255.0, floor(cost / 256.0) / 255.0, 0.0, 1.0);\n"
+            "    }\n"
+            "    else {\n"
+            "        gl_FragColor = vec4(mix(gl_FragColor.rgb, heat, 0.75), 1.0);\n"
+            "    }\n"
+            "}\n";
+    }
+
     prolog += "#line 1\n";
 
     const GLchar* sources[3] = {
         (const GLchar*) prolog.c_str(),
-        (const GLchar*) _src.c_str(),
-        (const GLchar*) epilog,
+        (const GLchar*) src->c_str(),
+        (const GLchar*) epilog.c_str(),
     };
 
     GLuint shader = glCreateShader(_type);
@@ -253,21 +529,22 @@ void Shader::detach(GLenum _type) {
     }
 }
 
-GLint Shader::getUniformLocation(const std::string& _uniformName) const {
-    GLint loc = glGetUniformLocation(m_program, _uniformName.c_str());
+GLint Shader::getUniformLocation(const char* _uniformName) const {
+    glCounters.uniformCalls++;
+    GLint loc = glGetUniformLocation(m_program, _uniformName);
     if(loc == -1){
         // std::cerr << "Uniform " << _uniformName << " not found" << std::endl;
     }
     return loc;
 }
 
-void Shader::setUniform(const std::string& _name, int _x) {
+void Shader::setUniform(const char* _name, int _x) {
     if(isInUse()) {
         glUniform1i(getUniformLocation(_name), _x);
     }
 }
 
-void Shader::setUniform(const std::string& _name, const float *_array, unsigned int _size) {
+void Shader::setUniform(const char* _name, const float *_array, unsigned int _size) {
     GLint loc = getUniformLocation(_name);
     if(isInUse()) {
         if (_size == 1) {
@@ -288,35 +565,35 @@ void Shader::setUniform(const std::string& _name, const float *_array, unsigned
     }
 }
 
-void Shader::setUniform(const std::string& _name, float _x) {
+void Shader::setUniform(const char* _name, float _x) {
     if(isInUse()) {
         glUniform1f(getUniformLocation(_name), _x);
         // std::cout << "Uniform " << _name << ": float(" << _x << ")" << std::endl;
     }
 }
 
-void Shader::setUniform(const std::string& _name, float _x, float _y) {
+void Shader::setUniform(const char* _name, float _x, float _y) {
     if(isInUse()) {
         glUniform2f(getUniformLocation(_name), _x, _y);
         // std::cout << "Uniform " << _name << ": vec2(" << _x << "," << _y << ")" << std::endl;
     }
 }
 
-void Shader::setUniform(const std::string& _name, float _x, float _y, float _z) {
+void Shader::setUniform(const char* _name, float _x, float _y, float _z) {
     if(isInUse()) {
         glUniform3f(getUniformLocation(_name), _x, _y, _z);
         // std::cout << "Uniform " << _name << ": vec3(" << _x << "," << _y << "," << _z <<")" << std::endl;
     }
 }
 
-void Shader::setUniform(const std::string& _name, float _x, float _y, float _z, float _w) {
+void Shader::setUniform(const char* _name, float _x, float _y, float _z, float _w) {
     if(isInUse()) {
         glUniform4f(getUniformLocation(_name), _x, _y, _z, _w);
         // std::cout << "Uniform " << _name << ": vec3(" << _x << "," << _y << "," << _z <<")" << std::endl;
     }
 }
 
-void Shader::setUniform(const std::string& _name, const Texture* _tex, unsigned int _texLoc){
+void Shader::setUniform(const char* _name, const Texture* _tex, unsigned int _texLoc){
     if(isInUse()) {
         glActiveTexture(GL_TEXTURE0 + _texLoc);
         glBindTexture(GL_TEXTURE_2D, _tex->getId());
@@ -324,7 +601,7 @@ void Shader::setUniform(const std::string& _name, const Texture* _tex, unsigned
     }
 }
 
-void Shader::setUniform(const std::string& _name, const Fbo* _fbo, unsigned int _texLoc){
+void Shader::setUniform(const char* _name, const Fbo* _fbo, unsigned int _texLoc){
     if(isInUse()) {
         glActiveTexture(GL_TEXTURE0 + _texLoc);
         glBindTexture(GL_TEXTURE_2D, _fbo->getTextureId());
@@ -332,19 +609,19 @@ void Shader::setUniform(const std::string& _name, const Fbo* _fbo, unsigned int
     }
 }
 
-void Shader::setUniform(const std::string& _name, const glm::mat2& _value, bool _transpose){
+void Shader::setUniform(const char* _name, const glm::mat2& _value, bool _transpose){
     if(isInUse()) {
         glUniformMatrix2fv(getUniformLocation(_name), 1, _transpose, &_value[0][0]);
     }
 }
 
-void Shader::setUniform(const std::string& _name, const glm::mat3& _value, bool _transpose){
+void Shader::setUniform(const char* _name, const glm::mat3& _value, bool _transpose){
     if(isInUse()) {
         glUniformMatrix3fv(getUniformLocation(_name), 1, _transpose, &_value[0][0]);
     }
 }
 
-void Shader::setUniform(const std::string& _name, const glm::mat4& _value, bool _transpose){
+void Shader::setUniform(const char* _name, const glm::mat4& _value, bool _transpose){
     if(isInUse()) {
         glUniformMatrix4fv(getUniformLocation(_name), 1, _transpose, &_value[0][0]);
     }
@@ -9,6 +9,26 @@
 #include "texture.h"
 #include "fbo.h"
 
+//  Fragment shaders loaded with this define count the iterations of their loops (and what they
+//  add with HEATMAP_COST(n)) and show them as a heatmap, see Shader::compileShader
+#define SHADER_HEATMAP_DEFINE "HEATMAP"
+
+//  The #define line of a define given as NAME, NAME=value or "NAME value" (as -D and --bench-variant
+//  take them). The first = is what separates the name from the value
+std::string getDefineLine(const std::string& _define);
+
+//  What is known of a linked program: how long it took and what the driver says about it
+//  (-1 where it doesn't)
+struct ShaderStats {
+    double  compileTime = 0.0;      // milliseconds, both stages
+    double  linkTime = 0.0;         // milliseconds
+    int     binarySize = -1;        // bytes, GL_PROGRAM_BINARY_LENGTH
+    int     instructions = -1;      // GL_PROGRAM_INSTRUCTIONS_ARB
+    int     textureFetches = -1;    // GL_PROGRAM_TEX_INSTRUCTIONS_ARB
+    int     uniforms = 0;           // active ones
+    int     samplers = 0;           // of those, the 2D and cube samplers
+};
+
 class Shader {
 
 public:
@@ -28,38 +48,46 @@ public:
     const   bool    needView2d() const { return m_view2d; };
     const   bool    needView3d() const { return m_view3d; };
 
+    const   ShaderStats& getStats() const { return m_stats; };
+
     void    use() const;
     bool    isInUse() const;
 
     const   GLint   getAttribLocation(const std::string& _attribute) const;
+    //  True if the linked program uses the uniform _name
+    bool    hasUniform(const std::string& _name) const { return getUniformLocation(_name.c_str()) != -1; };
     bool    load(const std::string& _fragmentSrc, const std::string& _vertexSrc, const std::vector<std::string> &_defines, bool _verbose = false);
 
-    void    setUniform(const std::string& _name, int _x);
+    //  Names are C strings, so literals don't make a std::string (and a heap allocation) per call
+    void    setUniform(const char* _name, int _x);
 
-    void    setUniform(const std::string& _name, float _x);
-    void    setUniform(const std::string& _name, float _x, float _y);
-    void    setUniform(const std::string& _name, float _x, float _y, float _z);
-    void    setUniform(const std::string& _name, float _x, float _y, float _z, float _w);
+    void    setUniform(const char* _name, float _x);
+    void    setUniform(const char* _name, float _x, float _y);
+    void    setUniform(const char* _name, float _x, float _y, float _z);
+    void    setUniform(const char* _name, float _x, float _y, float _z, float _w);
 
-    void    setUniform(const std::string& _name, const float *_array, unsigned int _size);
+    void    setUniform(const char* _name, const float *_array, unsigned int _size);
 
-    void    setUniform(const std::string& _name, const Texture* _tex, unsigned int _texLoc);
-    void    setUniform(const std::string& _name, const Fbo* _fbo, unsigned int _texLoc);
+    void    setUniform(const char* _name, const Texture* _tex, unsigned int _texLoc);
+    void    setUniform(const char* _name, const Fbo* _fbo, unsigned int _texLoc);
 
-    void    setUniform(const std::string& _name, const glm::vec2& _value) { setUniform(_name,_value.x,_value.y); }
-    void    setUniform(const std::string& _name, const glm::vec3& _value) { setUniform(_name,_value.x,_value.y,_value.z); }
-    void    setUniform(const std::string& _name, const glm::vec4& _value) { setUniform(_name,_value.x,_value.y,_value.z,_value.w); }
+    void    setUniform(const char* _name, const glm::vec2& _value) { setUniform(_name,_value.x,_value.y); }
+    void    setUniform(const char* _name, const glm::vec3& _value) { setUniform(_name,_value.x,_value.y,_value.z); }
+    void    setUniform(const char* _name, const glm::vec4& _value) { setUniform(_name,_value.x,_value.y,_value.z,_value.w); }
 
-    void    setUniform(const std::string& _name, const glm::mat2& _value, bool transpose = false);
-    void    setUniform(const std::string& _name, const glm::mat3& _value, bool transpose = false);
-    void    setUniform(const std::string& _name, const glm::mat4& _value, bool transpose = false);
+    void    setUniform(const char* _name, const glm::mat2& _value, bool transpose = false);
+    void    setUniform(const char* _name, const glm::mat3& _value, bool transpose = false);
+    void    setUniform(const char* _name, const glm::mat4& _value, bool transpose = false);
 
     void    detach(GLenum type);
 
 private:
 
     GLuint  compileShader(const std::string& _src, const std::vector<std::string> &_defines, GLenum _type);
-    GLint   getUniformLocation(const std::string& _uniformName) const;
+    GLint   getUniformLocation(const char* _uniformName) const;
+    void    queryStats();
+
+    ShaderStats m_stats;
 
     GLuint  m_program;
     GLuint  m_fragmentShader;
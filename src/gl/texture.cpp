@@ -1,5 +1,7 @@
 #include <iostream>
 #include "texture.h"
+#include "counters.h"
+#include "tools/trace.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "std/stb_image.h"
@@ -11,10 +13,12 @@ Texture::Texture():m_path(""),m_width(0),m_height(0),m_id(0) {
 }
 
 Texture::~Texture() {
+	glCounters.textureBytes -= (long long)m_width * m_height * 4;
 	glDeleteTextures(1, &m_id);
 }
 
 bool Texture::load(const std::string& _path, bool _vFlip) {
+    TRACE_ZONE("Texture::load");
     stbi_set_flip_vertically_on_load(_vFlip);
     int comp;
     unsigned char* pixels = stbi_load(_path.c_str(), &m_width, &m_height, &comp, STBI_rgb_alpha);
@@ -30,6 +34,7 @@ bool Texture::load(const std::string& _path, bool _vFlip) {
 }
 
 bool Texture::load(unsigned char* _pixels, int _width, int _height) {
+    glCounters.textureBytes += (long long)_width * _height * 4 - (long long)m_width * m_height * 4;
     m_width = _width;
     m_height = _height;
 
@@ -93,6 +98,19 @@ bool Texture::savePixels(const std::string& _path, unsigned char* _pixels, int _
     return true;
 }
 
+bool Texture::loadPixels(const std::string& _path, std::vector<unsigned char>& _pixels, int& _width, int& _height) {
+    stbi_set_flip_vertically_on_load(true);
+    int comp;
+    unsigned char* pixels = stbi_load(_path.c_str(), &_width, &_height, &comp, STBI_rgb_alpha);
+    if (pixels == NULL) {
+        return false;
+    }
+
+    _pixels.assign(pixels, pixels + _width * _height * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
 void Texture::bind() {
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, m_id);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "gl.h"
 
@@ -13,6 +14,8 @@ public:
 	bool load(unsigned char* _pixels, int _width, int _height);
 
 	static bool savePixels(const std::string& _path, unsigned char* _pixels, int _width, int _height);
+	/* RGBA pixels of an image, bottom row first like glReadPixels gives them (and savePixels takes them) */
+	static bool loadPixels(const std::string& _path, std::vector<unsigned char>& _pixels, int& _width, int& _height);
 
 	const GLuint getId() const { return m_id; };
 	std::string	 getFilePath() const { return m_path; };
@@ -27,6 +27,7 @@ bool parseUniforms(const std::string &_line, UniformList *_uniforms) {
 
         // Set total amount of values
         (*_uniforms)[name].size = index-1;
+        rta = true;
     }
     return rta;
 }
@@ -1,14 +1,18 @@
 #include "vbo.h"
+#include "counters.h"
 #include <iostream>
 
-Vbo::Vbo(VertexLayout* _vertexLayout, GLenum _drawMode) : m_vertexLayout(_vertexLayout), m_glVertexBuffer(0), m_nVertices(0), m_glIndexBuffer(0), m_nIndices(0), m_isUploaded(false) {
+Vbo::Vbo(VertexLayout* _vertexLayout, GLenum _drawMode) : m_vertexLayout(_vertexLayout), m_glVertexBuffer(0), m_nVertices(0), m_glIndexBuffer(0), m_nIndices(0), m_lod(0), m_isUploaded(false) {
     setDrawMode(_drawMode);
 }
 
-Vbo::Vbo() : m_vertexLayout(NULL), m_glVertexBuffer(0), m_nVertices(0), m_glIndexBuffer(0), m_nIndices(0), m_isUploaded(false) {
+Vbo::Vbo() : m_vertexLayout(NULL), m_glVertexBuffer(0), m_nVertices(0), m_glIndexBuffer(0), m_nIndices(0), m_lod(0), m_isUploaded(false) {
 }
 
 Vbo::~Vbo() {
+    if (m_isUploaded) {
+        glCounters.bufferBytes -= (long long)m_nVertices * m_vertexLayout->getStride() + (long long)m_nIndices * sizeof(INDEX_TYPE);
+    }
     glDeleteBuffers(1, &m_glVertexBuffer);
     glDeleteBuffers(1, &m_glIndexBuffer);
 
@@ -44,6 +48,29 @@ void Vbo::setDrawMode(GLenum _drawMode) {
     }
 }
 
+void Vbo::setLodOffsets(const std::vector<int>& _offsets) {
+    m_lodOffsets = _offsets;
+    m_lod = 0;
+}
+
+void Vbo::setLod(int _lod) {
+    if (_lod < 0) {
+        _lod = 0;
+    }
+    else if (_lod >= numLods()) {
+        _lod = numLods() - 1;
+    }
+    m_lod = _lod;
+}
+
+int Vbo::numLodIndices(int _lod) const {
+    if (m_lodOffsets.size() == 0) {
+        return m_nIndices;
+    }
+    int end = (_lod + 1 < (int)m_lodOffsets.size())? m_lodOffsets[_lod + 1] : m_nIndices;
+    return end - m_lodOffsets[_lod];
+}
+
 void Vbo::addVertex(GLbyte* _vertex) {
     addVertices(_vertex, 1);
 }
@@ -54,7 +81,7 @@ void Vbo::addVertices(GLbyte* _vertices, int _nVertices) {
         return;
     }
 
-    // Only add up to 65535 vertices, any more will overflow our 16-bit indices
+    // Only add up to MAX_INDEX_VALUE vertices, any more will overflow our indices
     int indexSpace = MAX_INDEX_VALUE - m_nVertices;
     if (_nVertices > indexSpace) {
         _nVertices = indexSpace;
@@ -66,11 +93,11 @@ void Vbo::addVertices(GLbyte* _vertices, int _nVertices) {
     m_nVertices += _nVertices;
 }
 
-void Vbo::addIndex(GLushort* _index) {
+void Vbo::addIndex(INDEX_TYPE* _index) {
     addIndices(_index, 1);
 }
 
-void Vbo::addIndices(GLushort* _indices, int _nIndices) {
+void Vbo::addIndices(INDEX_TYPE* _indices, int _nIndices) {
     if (m_isUploaded) {
         std::cout << "Vbo cannot add indices after upload!" << std::endl;
         return;
@@ -86,6 +113,21 @@ void Vbo::addIndices(GLushort* _indices, int _nIndices) {
 }
 
 void Vbo::upload() {
+    upload(m_vertexData.data(), m_nVertices, m_indices.data(), m_nIndices);
+
+    m_vertexData.clear();
+    m_indices.clear();
+}
+
+void Vbo::upload(const GLbyte* _vertices, int _nVertices, const INDEX_TYPE* _indices, int _nIndices) {
+    if (m_isUploaded) {
+        std::cout << "Vbo cannot be uploaded twice!" << std::endl;
+        return;
+    }
+
+    m_nVertices = _nVertices;
+    m_nIndices = _nIndices;
+
     if (m_nVertices > 0) {
         // Generate vertex buffer, if needed
         if (m_glVertexBuffer == 0) {
@@ -94,7 +136,7 @@ void Vbo::upload() {
 
         // Buffer vertex data
         glBindBuffer(GL_ARRAY_BUFFER, m_glVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, m_vertexData.size(), m_vertexData.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, m_nVertices * m_vertexLayout->getStride(), _vertices, GL_STATIC_DRAW);
     }
 
     if (m_nIndices > 0) {
@@ -105,12 +147,10 @@ void Vbo::upload() {
 
         // Buffer element index data
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_glIndexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLushort), m_indices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_nIndices * sizeof(INDEX_TYPE), _indices, GL_STATIC_DRAW);
     }
 
-    m_vertexData.clear();
-    m_indices.clear();
-
+    glCounters.bufferBytes += (long long)m_nVertices * m_vertexLayout->getStride() + (long long)m_nIndices * sizeof(INDEX_TYPE);
     m_isUploaded = true;
 }
 
@@ -137,8 +177,10 @@ void Vbo::draw(const Shader* _shader) {
     m_vertexLayout->enable(_shader);
 
     // Draw as elements or arrays
+    glCounters.drawCalls++;
     if (m_nIndices > 0) {
-        glDrawElements(m_drawMode, m_nIndices, GL_UNSIGNED_SHORT, 0);
+        int first = (m_lodOffsets.size() > 0)? m_lodOffsets[m_lod] : 0;
+        glDrawElements(m_drawMode, numLodIndices(m_lod), INDEX_TYPE_GL, (const GLvoid*)(first * sizeof(INDEX_TYPE)));
     } else if (m_nVertices > 0) {
         glDrawArrays(m_drawMode, 0, m_nVertices);
     }
@@ -5,7 +5,16 @@
 #include "gl.h"
 #include "vertexLayout.h"
 
+// OpenGL ES 2.0 only guarantees 16-bit element indices
+#ifdef PLATFORM_RPI
+#define INDEX_TYPE GLushort
+#define INDEX_TYPE_GL GL_UNSIGNED_SHORT
 #define MAX_INDEX_VALUE 65535
+#else
+#define INDEX_TYPE GLuint
+#define INDEX_TYPE_GL GL_UNSIGNED_INT
+#define MAX_INDEX_VALUE 2147483647
+#endif
 
 /*
  * Vbo - Drawable collection of geometry contained in a vertex buffer and (optionally) an index buffer
@@ -42,15 +51,29 @@ public:
     void addVertices(GLbyte* _vertices, int _nVertices);
 
     /*
-     * Adds a single index to the mesh; indices are unsigned shorts
+     * Adds a single index to the mesh; indices are INDEX_TYPE (unsigned shorts on OpenGL ES)
      */
-    void addIndex(GLushort* _index);
+    void addIndex(INDEX_TYPE* _index);
 
     /*
      * Adds _nIndices indices to the mesh; _indices must be a pointer to the beginning of a contiguous
-     * block of _nIndices unsigned short indices
+     * block of _nIndices INDEX_TYPE indices
      */
-    void addIndices(GLushort* _indices, int _nIndices);
+    void addIndices(INDEX_TYPE* _indices, int _nIndices);
+
+    /*
+     * The index buffer can hold several levels of detail of the same geometry one after the other;
+     * _offsets[i] is the first index of level i, which ends where level i+1 starts
+     */
+    void setLodOffsets(const std::vector<int>& _offsets);
+
+    /*
+     * Selects the level of detail drawn by draw()
+     */
+    void setLod(int _lod);
+    int getLod() const { return m_lod; };
+    int numLods() const { return (m_lodOffsets.size() > 0)? m_lodOffsets.size() : 1; };
+    int numLodIndices(int _lod) const;
 
     int numIndices() const { return m_indices.size(); };
     int numVertices() const { return m_nVertices; };
@@ -62,6 +85,13 @@ public:
      */
     void upload();
 
+    /*
+     * Uploads _nVertices vertices and _nIndices indices straight from the given pointers into OpenGL
+     * buffer objects, without keeping a copy; the vertices must be structured according to the
+     * VertexLayout associated with this mesh. After this no more vertices or indices can be added
+     */
+    void upload(const GLbyte* _vertices, int _nVertices, const INDEX_TYPE* _indices, int _nIndices);
+
     /*
      * Renders the geometry in this mesh using the ShaderProgram _shader; if geometry has not already
      * been uploaded it will be uploaded at this point
@@ -76,10 +106,13 @@ private:
     GLuint  m_glVertexBuffer;
     int     m_nVertices;
 
-    std::vector<GLushort> m_indices;
+    std::vector<INDEX_TYPE> m_indices;
     GLuint  m_glIndexBuffer;
     int     m_nIndices;
 
+    std::vector<int> m_lodOffsets;
+    int     m_lod;
+
     GLenum  m_drawMode;
 
     bool    m_isUploaded;
@@ -41,6 +41,7 @@ VertexLayout::VertexLayout(std::vector<VertexAttrib> _attribs) : m_attribs(_attr
         }
 
         m_stride += byteSize;
+        m_attribNames.push_back("a_" + m_attribs[i].name);
 
         // TODO: Automatically add padding or warn if attributes are not byte-aligned
     }
@@ -55,7 +56,7 @@ void VertexLayout::enable(const Shader* _program) {
 
     // Enable all attributes for this layout
     for (unsigned int i = 0; i < m_attribs.size(); i++) {
-        const GLint location = _program->getAttribLocation("a_"+m_attribs[i].name);
+        const GLint location = _program->getAttribLocation(m_attribNames[i]);
         if (location != -1) {
             glEnableVertexAttribArray(location);
             glVertexAttribPointer(location, m_attribs[i].size, m_attribs[i].type, m_attribs[i].normalized, m_stride, m_attribs[i].offset);
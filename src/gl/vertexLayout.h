@@ -42,6 +42,7 @@ private:
     static std::map<GLint, GLuint> s_enabledAttribs; // Map from attrib locations to bound shader program
 
     std::vector<VertexAttrib> m_attribs;
+    std::vector<std::string> m_attribNames; // "a_" + name, as the shaders call them
     GLint m_stride;
 
     int m_positionAttribIndex;
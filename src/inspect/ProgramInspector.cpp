@@ -27,14 +27,15 @@ namespace minuseins {
         compile_fn = fn;
     }
 
-    void ProgramInspector::draw_gui(bool *p_open, std::vector<GLenum> draw_interfaces) {
+    void ProgramInspector::draw_gui(bool *p_open, const std::vector<GLenum>& draw_interfaces) {
         if(!*p_open) {
             return;
         }
-        auto window_name = "GPUProgram " + name;
-        ImGui::PushID(window_name.c_str());
+        // no strings built here, this runs every frame
+        ImGui::PushID("GPUProgram");
+        ImGui::PushID(name.c_str());
         if(nullptr != compile_fn) {
-            if(ImGui::SmallButton(std::string("recompile##").append(name).c_str())){
+            if(ImGui::SmallButton("recompile")){
                 ImGui::SameLine();
                 programId_ = compile_fn();
                 initialize();
@@ -60,9 +61,7 @@ namespace minuseins {
             for(auto& interface : draw_interfaces) {
                 if(containers.at(interface).empty()) continue;
 
-                std::string interface_str = getString(interface);
-                //std::string interface_str = "INTERFACE_PLACEHOLDER";
-                ImGui::Begin(interface_str.c_str());
+                ImGui::Begin(getString(interface).c_str());
                 ImGui::PushID(name.c_str());
                 ImGui::Separator();
                 ImGui::TextUnformatted(name.c_str());
@@ -75,6 +74,7 @@ namespace minuseins {
 //            ImGui::TreePop();
 //        }
         ImGui::PopID();
+        ImGui::PopID();
     }
 
     void ProgramInspector::initialize() {
@@ -58,7 +58,7 @@ namespace minuseins {
         explicit ProgramInspector(GLuint programId, const std::string& name = "_no_name_");
 
         void set_recompile_function(std::function<GLuint()> fn);
-        void draw_gui(bool *p_open, std::vector<GLenum> draw_interfaces = all_interfaces);
+        void draw_gui(bool *p_open, const std::vector<GLenum>& draw_interfaces = all_interfaces);
         void setHandlerFunction(GLenum interface, handler_fn hdl_fn);
         void setHandler(GLenum interface, std::unique_ptr<resource_handler> hdl);
         void initialize();
@@ -1,27 +1,48 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "tools/fs.h"
 #include "app.h"
 #include "tools/text.h"
 #include "tools/geom.h"
+#include "tools/geomKernels.h"
+#include "tools/pngWriter.h"
+#include "tools/eventQueue.h"
+#include "tools/allocations.h"
+#include "tools/frameStats.h"
+#include "tools/trace.h"
+#include "gl/counters.h"
 #include "gl/shader.h"
 #include "gl/vbo.h"
 #include "gl/texture.h"
 #include "gl/pingpong.h"
+#include "gl/frameFences.h"
+#include "gl/gpuTimer.h"
+#include "gl/renderGraph.h"
 #include "gl/uniform.h"
 #include "3d/camera.h"
 #include "types/shapes.h"
+#include "types/meshCache.h"
+#include "types/meshOptimizer.h"
 #include "glm/gtx/matrix_transform_2d.hpp"
 #include "glm/gtx/rotate_vector.hpp"
 
 #include "ui/cursor.h"
+#include "ui/perfOverlay.h"
 
 #include "inspect/ProgramInspector.h"
 
@@ -36,25 +57,26 @@ struct WatchFile {
     std::string path;
     bool vFlip;
     int lastChange;
+    int scene;      // the one it belongs to (-1 for textures, shared by all)
 };
 std::vector<WatchFile> files;
-std::mutex filesMutex;
-int fileChanged;
 
-UniformList uniforms;
-std::mutex uniformsMutex;
+//  What the watcher threads send to the render thread, which handles it at the start of a frame
+enum EventType {
+    EVENT_FILE_CHANGED = 0,     // file is the index of the changed one in files
+    EVENT_COMMAND               // line read from the console
+};
+struct Event {
+    EventType   type;
+    int         file;
+    std::string line;
+};
+EventQueue<Event> events;
+EventQueue<std::string> replies;    // to the console commands, in the same order
 
 std::string screenshotFile = "";
-std::mutex screenshotMutex;
-
-//  SHADER
-Shader shader;
-int iFrag = -1;
-std::string fragSource = "";
-const std::string* fragPath = nullptr;
-int iVert = -1;
-std::string vertSource = "";
-const std::string* vertPath = nullptr;
+int screenshotScene = -1;           // the whole window if -1
+
 bool verbose = true;
 
 //  CAMERA
@@ -74,26 +96,200 @@ glm::vec3 u_eye3d = glm::vec3(2.598076,3.0,4.5);
 glm::vec3 u_up3d = glm::vec3(-0.25,0.866025,-0.433013);
 
 //  ASSETS
-Vbo* vbo;
-int iGeom = -1;
-glm::mat4 model_matrix = glm::mat4(1.);
+bool useMeshCache = true;
+bool optimizeMesh = false;
+bool optimizeMeshOverdraw = false;
+bool useLods = false;
+#define LOD_PIXELS_PER_TRIANGLE 4.0
 std::string outputFile = "";
 
-// Textures
-std::map<std::string,Texture*> textures;
+// Textures, loaded once per file and shared by the scenes
+std::map<std::string,Texture*> textureCache;
 bool vFlip = true;
 
+// Compiled shaders, shared by the scenes with the same sources
+std::map<std::string, std::shared_ptr<Shader> > shaderCache;
+
 // Defines
 std::vector<std::string> defines;
 
 // Include folders
 std::vector<std::string> include_folders;
 
-// Backbuffer
-PingPong buffer;
+// Billboard to show the backbuffers
 Vbo* buffer_vbo;
 Shader buffer_shader;
 
+// Buffers (u_buffer0..N passes)
+std::string bufferVertSource = "";
+BufferOptions bufferOptions;        // --buffer-format, --buffer-scale
+
+// The main pass renders into the backbuffer, and from there to the screen, when it samples
+// u_backbuffer, its resolution is scaled (by --scale or `#pragma buffer main`) or it shares
+// the window with other scenes
+BufferOptions mainOptions;
+
+// Dynamic resolution (--target-fps): the scale of the main pass follows the frame time,
+// measured on the GPU where timer queries are available and on the CPU otherwise
+float targetFps = 0.0;
+float dynamicScale = 1.0;
+double dynamicScaleTime = 0.0;
+double frameTimeAverage = 0.0;
+#define DYNAMIC_SCALE_MIN 0.25
+#define DYNAMIC_SCALE_STEP 0.0625
+
+// Frame statistics (`stats` command): CPU time of the parts of a frame, and GPU time of its
+// passes where there are timer queries. Each pass covers all the scenes, so timers don't nest
+enum GpuPass {
+    GPU_PASS_BUFFERS = 0,
+    GPU_PASS_MAIN,
+    GPU_PASS_PRESENT,   // accumulation and the copy of offscreen targets to the window
+    GPU_PASS_GUI,
+    GPU_PASS_READBACK,  // screenshots
+    GPU_PASS_TOTAL
+};
+const char* gpuPassNames[GPU_PASS_TOTAL] = { "buffers", "main", "present", "gui", "readback" };
+GpuTimer gpuTimers[GPU_PASS_TOTAL];
+int gpuSections[GPU_PASS_TOTAL];
+double gpuTimes[GPU_PASS_TOTAL];    // newest result of each pass
+FrameStats frameStats;
+int statUpdate, statEvents, statUniforms, statDraw, statSwap, statReadback, statFrame;
+double uniformsTime = 0.0;          // uploading uniforms, added up over the frame
+
+// Heap allocations of the render thread (`stats`, --check-allocations). Frames where nothing
+// changes shouldn't make any once the first ALLOC_CHECK_WARMUP have filled the caches
+bool checkAllocations = false;
+bool frameChanged = true;           // input, events or new buffers since the last frame
+int allocatingFrames = 0;
+int statAllocations;
+#define ALLOC_CHECK_WARMUP 10
+
+// Performance overlay (--overlay, `overlay` command): the frame stats, GL calls and memory in an
+// ImGui window. The GPU frame is the sum of the passes, the GL calls are counted in GlCounters
+PerfOverlay perfOverlay;
+bool drawPerfOverlay = false;
+int statGpuFrame, statDrawCalls, statUniformCalls;
+double reloadTime = 0.0;            // milliseconds the last reloadShaders took
+
+// GL calls (`gl_calls` command, --gl-calls to print them on exit): counted per function, with
+// the ones that set state to what it already was, when built with GL_CALL_COUNTING
+bool glCallsOnExit = false;
+
+// Shader statistics (`shader_stats` command, --shader-stats): what the driver says about the
+// main shader of each scene and its GPU time per pixel, measured where there is a single scene.
+// With --shader-stats they are appended to <shader>.stats.jsonl, keyed by the hash of the
+// sources and defines, after SHADER_STATS_FRAMES frames
+bool shaderStatsLog = false;
+#define SHADER_STATS_FRAMES 60
+
+// Heatmap (--heatmap, `heatmap` command): the main shaders are compiled counting the iterations
+// of their loops, shown in false color up to heatmapMax. The histogram of the counts of a scene
+// (`heatmap_histogram`) is read back from a frame rendered with the raw counts
+bool heatmap = false;
+bool heatmapRaw = false;
+float heatmapMax = 64.0;
+#define HEATMAP_BINS 16
+
+// Progressive accumulation (--accumulate N): each frame of the main pass is one more sample,
+// averaged into a float buffer until there are N of them (0 for no limit) or something changes
+bool accumulate = false;
+int accumulateLimit = 0;
+int frameIndex = 0;
+
+//  SCENES
+//  A shader with its geometry, textures, uniforms and buffers. Every `--scene` argument starts
+//  a new one; they are laid out in a grid on the window, sharing the GL context, the camera
+//  and the caches of textures and shaders
+struct Scene {
+    ~Scene() { delete vbo; };
+
+    std::shared_ptr<Shader> shader;
+    int         iFrag = -1;
+    std::string fragSource = "";
+    int         iVert = -1;
+    std::string vertSource = "";
+
+    Vbo*        vbo = nullptr;
+    int         iGeom = -1;
+    glm::mat4   model_matrix = glm::mat4(1.);
+    glm::vec3   model_center = glm::vec3(0.);   // bounding sphere of the geometry, in model space
+    float       model_radius = 0.0;
+
+    std::map<std::string,Texture*> textures;    // from the textureCache
+    UniformList uniforms;
+
+    PingPong    buffer;
+    RenderGraph renderGraph;
+    BufferOptions mainTarget;
+
+    Fbo         accumulation;
+    int         sampleIndex = 0;
+    bool        accumulationReset = false;
+
+    glm::ivec4  viewport = glm::ivec4(0);       // part of the window it is shown in
+
+    int         shaderFrames = 0;               // drawn with the current shader, for its stats
+    int         shaderGpuFrames = 0;            // of those, the ones with a GPU time
+    double      shaderGpuTime = 0.0;
+};
+std::vector<Scene*> scenes;
+
+// Tiled rendering (--tile-render WxH): the output is rendered offscreen in tiles of up to
+// TILE_RENDER_SIZE pixels and streamed, a row of tiles at a time, to the -o PNG
+glm::ivec2 tileRenderSize = glm::ivec2(0);
+#define TILE_RENDER_SIZE 2048
+
+// Benchmark (--bench N): each variant of the main shader, the defines of a --bench-variant on top
+// of the -D ones, renders BENCH_WARMUP_FRAMES and then N frames offscreen, one at a time. The
+// statistics of their times are printed as JSON
+int benchFrames = 0;
+std::vector<std::string> benchVariants;
+#define BENCH_WARMUP_FRAMES 10
+
+// Golden image comparison (--compare <golden>.png): the main shader renders offscreen with the
+// clock stopped and the last frame is compared to the golden image, in YIQ space so differences
+// count as much as they are seen. More than compareTolerance percent of pixels differing past
+// COMPARE_PIXEL_THRESHOLD fails, and so does a median frame time compareMaxSlowdown percent over
+// the one recorded in compareBaseline (<golden>.png.ms by default). The references are only
+// written with --update-golden, but a missing frame time is recorded, as it belongs to the machine
+std::string compareFile = "";
+std::string compareBaseline = "";
+bool updateGolden = false;
+float compareTolerance = 0.1;
+float compareMaxSlowdown = 25.0;
+bool compareFailed = false;
+#define COMPARE_FRAMES 60
+#define COMPARE_PIXEL_THRESHOLD 0.1
+
+// Fixed clock (--fixed-time <seconds>): u_time doesn't move, for renders that have to be the
+// same every time. Negative follows the clock
+double fixedTime = -1.0;
+
+// On demand rendering (--on-demand): frames are only drawn when something changes or the
+// shader is animated, otherwise the render loop sleeps waiting for events
+bool onDemand = false;
+int redrawFrames = 1;
+double idleTime = 0.0;
+std::chrono::steady_clock::time_point idleStatsStart = std::chrono::steady_clock::now();
+float idlePercent = 0.0;
+#define IDLE_WAIT_MAX 1.0
+
+// Frame pacing: vsync (--no-vsync), a frame rate cap (--max-fps) and how many frames the CPU can
+// queue ahead of the GPU (--frames-in-flight). The latency goes from reading the input to the GPU
+// finishing the frame (to the swap where there are no fences)
+bool vsync = true;
+float maxFps = 0.0;
+int framesInFlight = 0;
+FrameFences frameFences;
+double latency = 0.0;
+double latencyAverage = 0.0;
+#define FRAME_SPIN_TIME 0.002
+
+// Buffers follow the window size once it stops changing for a moment
+glm::ivec2 resizeSize = glm::ivec2(0);
+double resizeTime = -1.0;
+#define RESIZE_DEBOUNCE 0.2
+
 // Inspector
 
 std::unique_ptr<minuseins::ProgramInspector> inspect;
@@ -108,9 +304,44 @@ void cinWatcherThread();
 //================================================================= Functions
 void setup();
 void draw();
-
-void screenshot(std::string file);
-
+unsigned int setCommonUniforms(Scene& _scene, Shader& _shader, int _width, int _height);
+std::shared_ptr<Shader> loadShader(const std::string& _fragSource, const std::string& _vertSource);
+Texture* loadTexture(const std::string& _path);
+void reloadShaders(Scene& _scene);
+std::string getShaderStats(Scene& _scene);
+bool logShaderStats(Scene& _scene);
+void setHeatmap(bool _on);
+std::string getHeatmapHistogram(Scene& _scene);
+void layoutScenes(int _width, int _height);
+void allocateMainTarget(Scene& _scene);
+void updateDynamicScale(double _frameTime);
+void resetAccumulation(Scene& _scene);
+void resetAccumulation();
+void requestRedraw();
+void updateLatency(std::chrono::steady_clock::time_point _inputTime);
+void limitFrameRate();
+bool needsFrame();
+void waitForChanges(double _timeout);
+bool isConverged(const Scene& _scene);
+bool isOffscreen(const Scene& _scene);
+void renderBuffers(Scene& _scene);
+void renderMain(Scene& _scene);
+void presentScene(Scene& _scene);
+bool collectGpuTimes();
+void showBuffer(Fbo* _fbo, const glm::ivec4& _viewport);
+bool renderTiles(Scene& _scene, const std::string& _file, int _width, int _height);
+bool runBench(Scene& _scene, int _frames);
+void timeFrames(Scene& _scene, std::vector<double>& _times);
+bool runCompare(Scene& _scene, const std::string& _golden);
+double getColorDifference(const unsigned char* _a, const unsigned char* _b);
+
+bool loadGeometry(Scene& _scene, const std::string& _path);
+int selectLod(Scene& _scene);
+
+void screenshot(std::string file, int _scene = -1);
+
+bool processEvents();
+std::string runCommand(const std::string& _command);
 void onFileChange(int index);
 void onExit();
 void printUsage(char *);
@@ -158,6 +389,49 @@ int main(int argc, char **argv){
         else if (   std::string(argv[i]) == "--headless" ) {
             headless = true;
         }
+        else if (   std::string(argv[i]) == "--tile-render" ) {
+            i++;
+            std::vector<std::string> size = split(std::string(argv[i]), 'x');
+            if (size.size() == 2) {
+                tileRenderSize = glm::ivec2(toInt(size[0]), toInt(size[1]));
+            }
+            if (tileRenderSize.x <= 0 || tileRenderSize.y <= 0) {
+                std::cerr << "The size of --tile-render has to be <width>x<height>" << std::endl;
+                displayHelp = true;
+            }
+            headless = true;
+        }
+        else if (   std::string(argv[i]) == "--target-fps" ) {
+            i++;
+            targetFps = toFloat(std::string(argv[i]));
+            if (targetFps > 0.0) {
+                std::cout << "// Will scale the resolution to render at " << targetFps << " fps." << std::endl;
+            }
+            else {
+                std::cerr << "The fps of --target-fps have to be more than 0, not " << argv[i] << std::endl;
+                displayHelp = true;
+            }
+        }
+        else if (   std::string(argv[i]) == "--bench" ) {
+            i++;
+            benchFrames = toInt(std::string(argv[i]));
+            if (benchFrames <= 0) {
+                std::cerr << "The frames of --bench have to be more than 0, not " << argv[i] << std::endl;
+                displayHelp = true;
+            }
+            headless = true;
+        }
+        else if (   std::string(argv[i]) == "--compare" ) {
+            i++;
+            compareFile = std::string(argv[i]);
+            headless = true;
+        }
+        else if (   std::string(argv[i]) == "--trace" ) {
+            // Started before anything is loaded, to see it
+            i++;
+            traceStart(std::string(argv[i]));
+            traceThreadName("render");
+        }
         else if (   std::string(argv[i]) == "--help" ) {
             displayHelp = true;
         }
@@ -199,12 +473,17 @@ int main(int argc, char **argv){
     #endif
 
     //Load the the resources (textures)
+    Scene* scene = new Scene();
+    scenes.push_back(scene);
     for (int i = 1; i < argc ; i++){
         std::string argument = std::string(argv[i]);
 
         if (argument == "-x" || argument == "-y" ||
             argument == "-w" || argument == "--width" ||
-            argument == "-h" || argument == "--height" ) {
+            argument == "-h" || argument == "--height" ||
+            argument == "--tile-render" || argument == "--trace" ||
+            argument == "--bench" || argument == "--compare" ||
+            argument == "--target-fps" ) {
             i++;
         }
         else if (argument == "-l" ||
@@ -217,6 +496,131 @@ int main(int argc, char **argv){
         else if (argument == "-c" || argument == "--cursor") {
             cursor.init();
         }
+        else if (argument == "--no-mesh-cache") {
+            useMeshCache = false;
+        }
+        else if (argument == "--optimize-mesh") {
+            optimizeMesh = true;
+        }
+        else if (argument == "--optimize-overdraw") {
+            optimizeMesh = true;
+            optimizeMeshOverdraw = true;
+        }
+        else if (argument == "--lod") {
+            useLods = true;
+        }
+        else if (argument == "--scale") {
+            i++;
+            argument = std::string(argv[i]);
+            mainOptions.scale = toFloat(argument);
+            if (mainOptions.scale <= 0.0 || mainOptions.scale > 1.0) {
+                std::cerr << "The scale has to be in (0,1], not " << argument << std::endl;
+                mainOptions.scale = 1.0;
+            }
+        }
+        else if (argument == "--no-vsync") {
+            vsync = false;
+        }
+        else if (argument == "--max-fps") {
+            i++;
+            argument = std::string(argv[i]);
+            maxFps = toFloat(argument);
+        }
+        else if (argument == "--frames-in-flight") {
+            i++;
+            argument = std::string(argv[i]);
+            framesInFlight = toInt(argument);
+            if (framesInFlight < 0 || framesInFlight > FRAME_FENCES_MAX) {
+                std::cerr << "The frames in flight have to be between 0 (no bound) and " << FRAME_FENCES_MAX << ", not " << argument << std::endl;
+                framesInFlight = 0;
+            }
+            else if (!FrameFences::isSupported()) {
+                std::cerr << "There are no fences to bound the frames in flight with" << std::endl;
+            }
+        }
+        else if (argument == "--bench-variant") {
+            i++;
+            benchVariants.push_back(std::string(argv[i]));
+        }
+        else if (argument == "--scene") {
+            scene = new Scene();
+            scenes.push_back(scene);
+            textureCounter = 0;
+        }
+        else if (argument == "--fixed-time") {
+            i++;
+            fixedTime = toDouble(std::string(argv[i]));
+        }
+        else if (argument == "--compare-tolerance") {
+            i++;
+            compareTolerance = toFloat(std::string(argv[i]));
+        }
+        else if (argument == "--max-slowdown") {
+            i++;
+            compareMaxSlowdown = toFloat(std::string(argv[i]));
+        }
+        else if (argument == "--compare-baseline") {
+            i++;
+            compareBaseline = std::string(argv[i]);
+        }
+        else if (argument == "--update-golden") {
+            updateGolden = true;
+        }
+        else if (argument == "--gl-calls") {
+            glCallsOnExit = true;
+            if (!glCallsAvailable()) {
+                std::cerr << "// GL calls are only counted when built with GL_CALL_COUNTING (cmake -DGL_CALL_COUNTING=ON)" << std::endl;
+            }
+        }
+        else if (argument == "--overlay") {
+            drawPerfOverlay = true;
+        }
+        else if (argument == "--shader-stats") {
+            shaderStatsLog = true;
+        }
+        else if (argument == "--heatmap") {
+            i++;
+            heatmap = true;
+            heatmapMax = toFloat(std::string(argv[i]));
+            if (heatmapMax <= 0.0) {
+                std::cerr << "The --heatmap maximum has to be more than 0" << std::endl;
+                heatmapMax = 64.0;
+            }
+        }
+        else if (argument == "--check-allocations") {
+            checkAllocations = true;
+        }
+        else if (argument == "--on-demand") {
+            onDemand = true;
+        }
+        else if (argument == "--accumulate") {
+            i++;
+            argument = std::string(argv[i]);
+            accumulate = true;
+            accumulateLimit = toInt(argument);
+            if (accumulateLimit > 0) {
+                std::cout << "// Will accumulate " << accumulateLimit << " samples per pixel." << std::endl;
+            }
+        }
+        else if (argument == "--buffer-scale") {
+            i++;
+            argument = std::string(argv[i]);
+            bufferOptions.scale = toFloat(argument);
+            if (bufferOptions.scale <= 0.0 || bufferOptions.scale > 1.0) {
+                std::cerr << "The buffer scale has to be in (0,1], not " << argument << std::endl;
+                bufferOptions.scale = 1.0;
+            }
+        }
+        else if (argument == "--buffer-format") {
+            i++;
+            argument = std::string(argv[i]);
+            if (Fbo::parseFormat(argument, bufferOptions.format)) {
+                mainOptions.format = bufferOptions.format;
+            }
+            else {
+                std::cerr << "Unknown buffer format " << argument << ", use RGBA8, RGBA16F, RGBA32F or R32F" << std::endl;
+            }
+        }
         else if (argument == "-s" || argument == "--sec") {
             i++;
             argument = std::string(argv[i]);
@@ -234,7 +638,7 @@ int main(int argc, char **argv){
                 std::cerr << "At the moment screenshots only support PNG formats" << std::endl;
             }
         }
-        else if (iFrag == -1 && (haveExt(argument,"frag") || haveExt(argument,"fs"))) {
+        else if (scene->iFrag == -1 && (haveExt(argument,"frag") || haveExt(argument,"fs"))) {
             if (stat(argument.c_str(), &st) != 0) {
                 std::cerr << "Error watching file " << argv[i] << std::endl;
             }
@@ -243,11 +647,12 @@ int main(int argc, char **argv){
                 file.type = "fragment";
                 file.path = argument;
                 file.lastChange = st.st_mtime;
+                file.scene = scenes.size()-1;
                 files.push_back(file);
-                iFrag = files.size()-1;
+                scene->iFrag = files.size()-1;
             }
         }
-        else if ( iVert == -1 && ( haveExt(argument,"vert") || haveExt(argument,"vs") ) ) {
+        else if ( scene->iVert == -1 && ( haveExt(argument,"vert") || haveExt(argument,"vs") ) ) {
             if (stat(argument.c_str(), &st) != 0) {
                 std::cerr << "Error watching file " << argument << std::endl;
             }
@@ -256,11 +661,13 @@ int main(int argc, char **argv){
                 file.type = "vertex";
                 file.path = argument;
                 file.lastChange = st.st_mtime;
+                file.scene = scenes.size()-1;
                 files.push_back(file);
-                iVert = files.size()-1;
+                scene->iVert = files.size()-1;
             }
         }
-        else if (iGeom == -1 && (   haveExt(argument,"ply") || haveExt(argument,"PLY") ||
+        else if (scene->iGeom == -1 && (   haveExt(argument,"glsv") ||
+                                    haveExt(argument,"ply") || haveExt(argument,"PLY") ||
                                     haveExt(argument,"obj") || haveExt(argument,"OBJ"))) {
             if (stat(argument.c_str(), &st) != 0) {
                 std::cerr << "Error watching file " << argument << std::endl;
@@ -270,8 +677,9 @@ int main(int argc, char **argv){
                 file.type = "geometry";
                 file.path = argument;
                 file.lastChange = st.st_mtime;
+                file.scene = scenes.size()-1;
                 files.push_back(file);
-                iGeom = files.size()-1;
+                scene->iGeom = files.size()-1;
             }
         }
         else if (argument == "-vFlip") {
@@ -280,28 +688,15 @@ int main(int argc, char **argv){
         else if (   haveExt(argument,"png") || haveExt(argument,"PNG") ||
                     haveExt(argument,"jpg") || haveExt(argument,"JPG") ||
                     haveExt(argument,"jpeg") || haveExt(argument,"JPEG")) {
-            if (stat(argument.c_str(), &st) != 0) {
-                std::cerr << "Error watching file " << argument << std::endl;
-            }
-            else {
-                Texture* tex = new Texture();
-
-                if (tex->load(argument, vFlip)) {
-                    std::string name = "u_tex"+toString(textureCounter);
-                    textures[name] = tex;
-
-                    WatchFile file;
-                    file.type = "image";
-                    file.path = argument;
-                    file.lastChange = st.st_mtime;
-                    file.vFlip = vFlip;
-                    files.push_back(file);
-
-                    std::cout << "// Loading " << argument << " as the following uniform: " << std::endl;
-                    std::cout << "//    uniform sampler2D " << name  << "; // loaded"<< std::endl;
-                    std::cout << "//    uniform vec2 " << name  << "Resolution;"<< std::endl;
-                    textureCounter++;
-                }
+            Texture* tex = loadTexture(argument);
+            if (tex != nullptr) {
+                std::string name = "u_tex"+toString(textureCounter);
+                scene->textures[name] = tex;
+
+                std::cout << "// Loading " << argument << " as the following uniform: " << std::endl;
+                std::cout << "//    uniform sampler2D " << name  << "; // loaded"<< std::endl;
+                std::cout << "//    uniform vec2 " << name  << "Resolution;"<< std::endl;
+                textureCounter++;
             }
         }
         else if (argument.find("-D") == 0) {
@@ -316,67 +711,135 @@ int main(int argc, char **argv){
             std::string parameterPair = argument.substr(argument.find_last_of('-')+1);
             i++;
             argument = std::string(argv[i]);
-            if (stat(argument.c_str(), &st) != 0) {
-                std::cerr << "Error watching file " << argument << std::endl;
-            }
-            else {
-                Texture* tex = new Texture();
-                if (tex->load(argument, vFlip)) {
-                    textures[parameterPair] = tex;
-
-                    WatchFile file;
-                    file.type = "image";
-                    file.path = argument;
-                    file.lastChange = st.st_mtime;
-                    file.vFlip = vFlip;
-                    files.push_back(file);
-
-                    std::cout << "// Loading " << argument << " as the following uniform: " << std::endl;
-                    std::cout << "//     uniform sampler2D " << parameterPair  << "; // loaded"<< std::endl;
-                    std::cout << "//     uniform vec2 " << parameterPair  << "Resolution;"<< std::endl;
-                }
+            Texture* tex = loadTexture(argument);
+            if (tex != nullptr) {
+                scene->textures[parameterPair] = tex;
+
+                std::cout << "// Loading " << argument << " as the following uniform: " << std::endl;
+                std::cout << "//     uniform sampler2D " << parameterPair  << "; // loaded"<< std::endl;
+                std::cout << "//     uniform vec2 " << parameterPair  << "Resolution;"<< std::endl;
             }
         }
     }
 
     // If no shader
-    if (iFrag == -1 && iVert == -1 && iGeom == -1) {
-        printUsage(argv[0]);
-        onExit();
-        exit(EXIT_FAILURE);
+    for (size_t i = 0; i < scenes.size(); i++) {
+        if (scenes[i]->iFrag == -1 && scenes[i]->iVert == -1 && scenes[i]->iGeom == -1) {
+            printUsage(argv[0]);
+            onExit();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!vsync) {
+        setVSync(false);
     }
 
     // Start watchers
-    fileChanged = -1;
     std::thread fileWatcher(&fileWatcherThread);
     std::thread cinWatcher(&cinWatcherThread);
 
     // Start working on the GL context
     setup();
 
+    if (tileRenderSize.x > 0) {
+        if (outputFile == "") {
+            std::cerr << "--tile-render needs a PNG file to save to (-o <file>.png)" << std::endl;
+        }
+        else if (renderTiles(*scenes[0], outputFile, tileRenderSize.x, tileRenderSize.y)) {
+            std::cout << "// Tiles saved to " << outputFile << std::endl;
+        }
+        // There is no window to take a screenshot of
+        outputFile = "";
+        bRun.store(false);
+    }
+    else if (benchFrames > 0) {
+        runBench(*scenes[0], benchFrames);
+        outputFile = "";
+        bRun.store(false);
+    }
+    else if (compareFile != "") {
+        compareFailed = !runCompare(*scenes[0], compareFile);
+        outputFile = "";
+        bRun.store(false);
+    }
+
     // Render Loop
     while (isGL() && bRun.load()) {
+        if (onDemand) {
+            // Wake up for the buffers to follow a new window size, and for the time limit
+            double timeout = -1.0;
+            if (resizeTime >= 0.0) {
+                timeout = RESIZE_DEBOUNCE;
+            }
+            if (timeLimit >= 0.0 && (timeout < 0.0 || timeLimit - getTime() < timeout)) {
+                timeout = (timeLimit > getTime())? timeLimit - getTime() : 0.0;
+            }
+            waitForChanges(timeout);
+        }
+
+        // Don't read the input until the GPU is close enough behind, or it waits in the queue
+        frameFences.wait(framesInFlight);
+        std::chrono::steady_clock::time_point inputTime = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point start = inputTime;
+        unsigned long allocations = getThreadAllocations();
+
         // Update
-        updateGL();
+        {
+            TRACE_ZONE("update");
+            updateGL();
+        }
+        frameStats.add(statUpdate, FrameStats::since(start));
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Something change??
-        if (fileChanged != -1) {
-            onFileChange(fileChanged);
-            filesMutex.lock();
-            fileChanged = -1;
-            filesMutex.unlock();
+        start = std::chrono::steady_clock::now();
+        {
+            TRACE_ZONE("events");
+            processEvents();
         }
+        frameStats.add(statEvents, FrameStats::since(start));
 
         // Draw
+        start = std::chrono::steady_clock::now();
         draw();
 
         // Draw Cursor
         cursor.draw();
+        frameStats.add(statDraw, FrameStats::since(start));
 
         // Swap the buffers
-        renderGL();
+        start = std::chrono::steady_clock::now();
+        {
+            TRACE_ZONE("swap");
+            renderGL(&gpuTimers[GPU_PASS_GUI]);
+        }
+        frameStats.add(statSwap, FrameStats::since(start));
+        updateLatency(inputTime);
+
+        frameStats.add(statFrame, FrameStats::since(inputTime));
+        unsigned long frameAllocations = getThreadAllocations() - allocations;
+        frameStats.add(statAllocations, frameAllocations);
+        frameStats.add(statDrawCalls, glCounters.drawCalls);
+        frameStats.add(statUniformCalls, glCounters.uniformCalls);
+        glCounters.resetFrame();
+        glCallsNextFrame();
+        frameStats.nextFrame();
+
+        if (checkAllocations && !frameChanged && frameIndex > ALLOC_CHECK_WARMUP && frameAllocations > 0) {
+            std::cerr << "// Frame " << frameIndex << " made " << frameAllocations << " heap allocations with nothing changing" << std::endl;
+            allocatingFrames++;
+        }
+        frameChanged = false;
+
+        if (maxFps > 0.0) {
+            limitFrameRate();
+        }
+
+        if (redrawFrames > 0) {
+            redrawFrames--;
+        }
 
         if (timeLimit >= 0.0 && getTime() >= timeLimit) {
             bRun.store(false);
@@ -397,123 +860,72 @@ int main(int argc, char **argv){
     pthread_t handler = cinWatcher.native_handle();
     pthread_cancel(handler);
 
+    if (compareFailed) {
+        exit(EXIT_FAILURE);
+    }
+    if (checkAllocations) {
+        std::cout << "// " << allocatingFrames << " frames made heap allocations with nothing changing" << std::endl;
+        exit(allocatingFrames > 0? EXIT_FAILURE : 0);
+    }
     exit(0);
 }
 
 //  Watching Thread
 //============================================================================
 void fileWatcherThread() {
+    traceThreadName("fileWatcher");
     struct stat st;
     while (bRun.load()) {
         for (uint i = 0; i < files.size(); i++) {
-            if (fileChanged == -1) {
+            {
+                TRACE_ZONE("stat");
                 stat(files[i].path.c_str(), &st);
-                int date = st.st_mtime;
-                if (date != files[i].lastChange ) {
-                    filesMutex.lock();
-                    fileChanged = i;
-                    files[i].lastChange = date;
-                    filesMutex.unlock();
-                }
-                usleep(500000);
             }
+            int date = st.st_mtime;
+            if (date != files[i].lastChange ) {
+                files[i].lastChange = date;
+
+                Event event;
+                event.type = EVENT_FILE_CHANGED;
+                event.file = i;
+                events.push(event);
+                wakeGL();
+            }
+            usleep(500000);
         }
     }
 }
 
+//  Commands are run by the render thread, which owns the state they read or change. This one
+//  waits for each reply before reading the next command, so they come out in order
 void cinWatcherThread() {
     std::string line;
+    std::string reply;
 
+    traceThreadName("cinWatcher");
     while (std::getline(std::cin, line)) {
-        if (line == "q" || line == "quit" || line == "exit") {
-            bRun.store(false);
-        }
-        else if (line == "fps") {
-            // std::cout << getFPS() << std::endl;
-            printf("%f\n", getFPS());
-        }
-        else if (line == "delta") {
-            // std::cout << getDelta() << std::endl;
-            printf("%f\n", getDelta());
-        }
-        else if (line == "time") {
-            // std::cout << getTime() << std::endl;
-            printf("%f\n", getTime());
-        }
-        else if (line == "date") {
-            glm::vec4 date = getDate();
-            std::cout << date.x << ',' << date.y << ',' << date.z << ',' << date.w << std::endl;
-        }
-        else if (line == "window_width") {
-            std::cout << getWindowWidth() << std::endl;
-        }
-        else if (line == "window_height") {
-            std::cout << getWindowHeight() << std::endl;
-        }
-        else if (line == "pixel_density") {
-            std::cout << getPixelDensity() << std::endl;
-        }
-        else if (line == "screen_size") {
-            glm::ivec2 screen_size = getScreenSize();
-            std::cout << screen_size.x << ',' << screen_size.y << std::endl;
-        }
-        else if (line == "viewport") {
-            glm::ivec4 viewport = getViewport();
-            std::cout << viewport.x << ',' << viewport.y << ',' << viewport.z << ',' << viewport.w << std::endl;
-        }
-        else if (line == "mouse_x") {
-            std::cout << getMouseX() << std::endl;
-        }
-        else if (line == "mouse_y") {
-            std::cout << getMouseY() << std::endl;
-        }
-        else if (line == "mouse") {
-            glm::vec2 pos = getMousePosition();
-            std::cout << pos.x << "," << pos.y << std::endl;
-        }
-        else if (line == "view3d") {
-            std::cout
-                << "eye=("
-                    << u_eye3d.x << "," << u_eye3d.y << "," << u_eye3d.z << ") "
-                << "centre=("
-                    << u_centre3d.x << "," << u_centre3d.y << ","
-                    << u_centre3d.z << ") "
-                << "up=("
-                    << u_up3d.x << "," << u_up3d.y << "," << u_up3d.z << ")"
-                << std::endl;
-        }
-        else if (line == "frag") {
-            std::cout << fragSource << std::endl;
-        }
-        else if (line == "vert") {
-            std::cout << vertSource << std::endl;
-        }
-        else if (beginsWith(line, "screenshot")) {
-            if (line == "screenshot" && outputFile != "") {
-                screenshotMutex.lock();
-                screenshotFile = outputFile;
-                screenshotMutex.unlock();
+        TRACE_ZONE("command");
+        Event event;
+        event.type = EVENT_COMMAND;
+        event.file = -1;
+        event.line = line;
+        events.push(event);
+        wakeGL();
+
+        // The reply wakes it up, the timeout is only to notice when glslViewer closes
+        while (!replies.pop(reply, std::chrono::milliseconds(100))) {
+            if (!bRun.load()) {
+                return;
             }
-            else {
-                std::vector<std::string> values = split(line,' ');
-                if (values.size() == 2) {
-                    screenshotMutex.lock();
-                    screenshotFile = values[1];
-                    screenshotMutex.unlock();
-                }
-            }
-        }
-        else {
-            uniformsMutex.lock();
-            parseUniforms(line, &uniforms);
-            uniformsMutex.unlock();
         }
+        std::cout << reply << std::flush;
     }
 }
 
 //  MAIN RENDER Thread (needs a GL context)
 //============================================================================
 void setup() {
+    TRACE_ZONE("setup");
     // Prepare viewport
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -521,50 +933,8 @@ void setup() {
     glEnable(GL_DEPTH_TEST);
     glFrontFace(GL_CCW);
 
-    //  Load Geometry
-    //
-    if (iGeom == -1){
-        vbo = rect(0.0,0.0,1.0,1.0).getVbo();
-    }
-    else {
-        Mesh model;
-        model.load(files[iGeom].path);
-        vbo = model.getVbo();
-        glm::vec3 toCentroid = getCentroid(model.getVertices());
-        // model_matrix = glm::scale(glm::vec3(0.001));
-        model_matrix = glm::translate(-toCentroid);
-    }
-
-    //  Build shader;
-    //
-    if (iFrag != -1) {
-        fragPath = &files[iFrag].path;
-        fragSource = "";
-        if(!loadFromPath(*fragPath, &fragSource, include_folders)) {
-            return;
-        }
-    }
-    else {
-        fragSource = vbo->getVertexLayout()->getDefaultFragShader();
-    }
-
-    if (iVert != -1) {
-        vertPath = &files[iVert].path;
-        vertSource = "";
-        loadFromPath(*vertPath, &vertSource, include_folders);
-    }
-    else {
-        vertSource = vbo->getVertexLayout()->getDefaultVertShader();
-    }
-
-    shader.load(fragSource, vertSource, defines, verbose);
-
-    inspect = std::make_unique<minuseins::ProgramInspector>(shader.getProgram());
-    inspect->initialize();
-    cam.setViewport(getWindowWidth(), getWindowHeight());
     cam.setPosition(glm::vec3(0.0,0.0,-3.));
-
-    buffer.allocate(getWindowWidth(), getWindowHeight(), false);
+    layoutScenes(getWindowWidth(), getWindowHeight());
 
     buffer_vbo = rect(0.0,0.0,1.0,1.0).getVbo();
     std::string buffer_vert = "#ifdef GL_ES\n\
@@ -572,8 +942,10 @@ precision mediump float;\n\
 #endif\n\
 \n\
 attribute vec4 a_position;\n\
+varying vec2 v_st;\n\
 \n\
 void main(void) {\n\
+    v_st = a_position.xy * 0.5 + 0.5;\n\
     gl_Position = a_position;\n\
 }";
 
@@ -582,14 +954,74 @@ precision mediump float;\n\
 #endif\n\
 \n\
 uniform sampler2D u_buffer;\n\
-uniform vec2 u_resolution;\n\
+varying vec2 v_st;\n\
 \n\
 void main() {\n\
-    vec2 st = gl_FragCoord.xy/u_resolution.xy;\n\
-    gl_FragColor = texture2D(u_buffer, st);\n\
+    gl_FragColor = texture2D(u_buffer, v_st);\n\
 }";
     buffer_shader.load(buffer_frag, buffer_vert, defines);
 
+    // Buffer passes render a billboard, whatever the geometry is
+    bufferVertSource = buffer_vbo->getVertexLayout()->getDefaultVertShader();
+
+    for (size_t i = 0; i < scenes.size(); i++) {
+        Scene& scene = *scenes[i];
+
+        //  Load Geometry
+        //
+        if (scene.iGeom == -1){
+            scene.vbo = rect(0.0,0.0,1.0,1.0).getVbo();
+        }
+        else if (!loadGeometry(scene, files[scene.iGeom].path)) {
+            scene.vbo = rect(0.0,0.0,1.0,1.0).getVbo();
+        }
+
+        //  Build shader;
+        //
+        if (scene.iFrag != -1) {
+            scene.fragSource = "";
+            loadFromPath(files[scene.iFrag].path, &scene.fragSource, include_folders);
+        }
+        else {
+            scene.fragSource = scene.vbo->getVertexLayout()->getDefaultFragShader();
+        }
+
+        if (scene.iVert != -1) {
+            scene.vertSource = "";
+            loadFromPath(files[scene.iVert].path, &scene.vertSource, include_folders);
+        }
+        else {
+            scene.vertSource = scene.vbo->getVertexLayout()->getDefaultVertShader();
+        }
+
+        scene.shader = loadShader(scene.fragSource, scene.vertSource);
+        allocateMainTarget(scene);
+
+        scene.renderGraph.setDefaultOptions(bufferOptions);
+        scene.renderGraph.load(scene.fragSource, bufferVertSource, defines, verbose);
+        scene.renderGraph.allocate(scene.viewport.z, scene.viewport.w);
+    }
+
+    statUpdate = frameStats.addSection("cpu", "update");
+    statEvents = frameStats.addSection("cpu", "events");
+    statUniforms = frameStats.addSection("cpu", "uniforms");
+    statDraw = frameStats.addSection("cpu", "draw");
+    statSwap = frameStats.addSection("cpu", "swap");
+    statReadback = frameStats.addSection("cpu", "readback");
+    statFrame = frameStats.addSection("cpu", "frame");
+    statAllocations = frameStats.addSection("allocations", "frame", true);
+    for (int i = 0; i < GPU_PASS_TOTAL; i++) {
+        gpuSections[i] = frameStats.addSection("gpu", gpuPassNames[i]);
+        gpuTimes[i] = 0.0;
+    }
+    statGpuFrame = frameStats.addSection("gpu", "frame");
+    statDrawCalls = frameStats.addSection("gl", "draws", true);
+    statUniformCalls = frameStats.addSection("gl", "uniforms", true);
+    perfOverlay.setGraphs(statFrame, statGpuFrame);
+
+    inspect = std::make_unique<minuseins::ProgramInspector>(scenes[0]->shader->getProgram());
+    inspect->initialize();
+
     // Turn on Alpha blending
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
@@ -600,144 +1032,1059 @@ void main() {\n\
 }
 
 void draw() {
-    if (shader.needBackbuffer()) {
-        buffer.swap();
-        buffer.src->bind();
+    TRACE_ZONE("draw");
+    if (resizeTime >= 0.0 && getTime() - resizeTime > RESIZE_DEBOUNCE) {
+        for (size_t i = 0; i < scenes.size(); i++) {
+            allocateMainTarget(*scenes[i]);
+            scenes[i]->renderGraph.allocate(scenes[i]->viewport.z, scenes[i]->viewport.w);
+        }
+        resizeTime = -1.0;
+        requestRedraw();
     }
 
-    shader.use();
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+    uniformsTime = 0.0;
 
-    // Pass uniforms
-    shader.setUniform("u_resolution", getWindowWidth(), getWindowHeight());
-    if (shader.needTime()) {
-        shader.setUniform("u_time", float(getTime()));
+    for (size_t i = 0; i < scenes.size(); i++) {
+        if (scenes[i]->accumulationReset) {
+            scenes[i]->sampleIndex = 0;
+            scenes[i]->accumulationReset = false;
+        }
     }
-    if (shader.needDelta()) {
-        shader.setUniform("u_delta", float(getDelta()));
+
+    // Once the image has converged there is nothing new to render, what was accumulated is shown again
+    gpuTimers[GPU_PASS_BUFFERS].begin();
+    for (size_t i = 0; i < scenes.size(); i++) {
+        if (!isConverged(*scenes[i])) {
+            renderBuffers(*scenes[i]);
+        }
     }
-    if (shader.needDate()) {
-        shader.setUniform("u_date", getDate());
+    gpuTimers[GPU_PASS_BUFFERS].end();
+
+    gpuTimers[GPU_PASS_MAIN].begin();
+    for (size_t i = 0; i < scenes.size(); i++) {
+        if (!isConverged(*scenes[i])) {
+            renderMain(*scenes[i]);
+            scenes[i]->shaderFrames++;
+        }
     }
-    if (shader.needMouse()) {
-        shader.setUniform("u_mouse", getMouseX(), getMouseY());
+    gpuTimers[GPU_PASS_MAIN].end();
+
+    gpuTimers[GPU_PASS_PRESENT].begin();
+    for (size_t i = 0; i < scenes.size(); i++) {
+        presentScene(*scenes[i]);
     }
-    if (shader.need_iMouse()) {
-        shader.setUniform("iMouse", get_iMouse());
+    gpuTimers[GPU_PASS_PRESENT].end();
+
+    frameIndex++;
+    frameStats.add(statUniforms, uniformsTime);
+
+    // Without timer queries wait for the GPU to be done to know how long it took
+    if (targetFps > 0.0 && !GpuTimer::isSupported()) {
+        glFinish();
+        updateDynamicScale(FrameStats::since(frameStart));
     }
-    if (shader.needView2d()) {
-        shader.setUniform("u_view2d", u_view2d);
+
+    if (screenshotFile != "") {
+        screenshot(screenshotFile, screenshotScene);
+        screenshotFile = "";
+        screenshotScene = -1;
     }
-    if (shader.needView3d()) {
-        shader.setUniform("u_eye3d", u_eye3d);
-        shader.setUniform("u_centre3d", u_centre3d);
-        shader.setUniform("u_up3d", u_up3d);
+
+    // The GPU time of the GUI is taken in renderGL(), where it is drawn
+    inspect->draw_gui(&draw_inspect);
+    perfOverlay.draw(&drawPerfOverlay, frameStats, scenes[0]->shader->getStats(), reloadTime);
+
+    if (collectGpuTimes() && targetFps > 0.0) {
+        updateDynamicScale(gpuTimes[GPU_PASS_BUFFERS] + gpuTimes[GPU_PASS_MAIN] + gpuTimes[GPU_PASS_PRESENT]);
     }
 
-    for (UniformList::iterator it=uniforms.begin(); it!=uniforms.end(); ++it) {
-        if (it->second.bInt) {
-            shader.setUniform(it->first, int(it->second.value[0]));
-        }
-        else {
-            shader.setUniform(it->first, it->second.value, it->second.size);
+    for (size_t i = 0; i < scenes.size(); i++) {
+        if (shaderStatsLog && scenes[i]->shaderFrames == SHADER_STATS_FRAMES) {
+            logShaderStats(*scenes[i]);
         }
     }
+}
+
+//  Accumulated all the samples it was asked for, there is nothing new to render
+bool isConverged(const Scene& _scene) {
+    return accumulate && accumulateLimit > 0 && _scene.sampleIndex >= accumulateLimit;
+}
+
+//  The main pass renders into the backbuffer instead of the window. Scenes that share the
+//  window are always rendered offscreen and shown in their part of it
+bool isOffscreen(const Scene& _scene) {
+    return _scene.shader->needBackbuffer() || _scene.mainTarget.scale != 1.0 || accumulate || scenes.size() > 1;
+}
+
+//  Render the buffers of _scene, in dependency order
+void renderBuffers(Scene& _scene) {
+    for (size_t i = 0; i < _scene.renderGraph.getOrder().size(); i++) {
+        int n = _scene.renderGraph.getOrder()[i];
+        RenderPass* pass = _scene.renderGraph[n];
+
+        pass->bind();
+        pass->shader.use();
+        unsigned int index = setCommonUniforms(_scene, pass->shader, pass->getWidth(), pass->getHeight());
+        pass->shader.setUniform("u_modelViewProjectionMatrix", glm::mat4(1.));
+        _scene.renderGraph.setUniforms(pass->shader, n, index);
+        buffer_vbo->draw(&pass->shader);
+        pass->unbind();
+    }
+}
+
+//  Render the main pass of _scene, to the window or to its backbuffer
+void renderMain(Scene& _scene) {
+    Shader& shader = *_scene.shader;
+
+    bool offscreen = isOffscreen(_scene);
+    if (offscreen) {
+        _scene.buffer.swap();
+        _scene.buffer.src->bind(_scene.mainTarget.load);
+    }
+
+    shader.use();
+    unsigned int index = offscreen? setCommonUniforms(_scene, shader, _scene.buffer.src->getWidth(), _scene.buffer.src->getHeight()) : setCommonUniforms(_scene, shader, getWindowWidth(), getWindowHeight());
 
     glm::mat4 mvp = glm::mat4(1.);
-    if (iGeom != -1) {
+    if (_scene.iGeom != -1) {
         shader.setUniform("u_eye", -cam.getPosition());
         shader.setUniform("u_normalMatrix", cam.getNormalMatrix());
 
-        shader.setUniform("u_modelMatrix", model_matrix);
+        shader.setUniform("u_modelMatrix", _scene.model_matrix);
         shader.setUniform("u_viewMatrix", cam.getViewMatrix());
         shader.setUniform("u_projectionMatrix", cam.getProjectionMatrix());
 
-        mvp = cam.getProjectionViewMatrix() * model_matrix;
+        mvp = cam.getProjectionViewMatrix() * _scene.model_matrix;
     }
     shader.setUniform("u_modelViewProjectionMatrix", mvp);
 
-    // Pass Textures Uniforms
-    unsigned int index = 0;
-    for (std::map<std::string,Texture*>::iterator it = textures.begin(); it!=textures.end(); ++it) {
-        shader.setUniform(it->first, it->second, index);
-        shader.setUniform(it->first+"Resolution", it->second->getWidth(), it->second->getHeight());
-        index++;
+    if (heatmap) {
+        shader.setUniform("u_heatmapMax", heatmapMax);
+        shader.setUniform("u_heatmapRaw", heatmapRaw? 1 : 0);
     }
 
+    _scene.renderGraph.setUniforms(shader, -1, index);
+
     if (shader.needBackbuffer()) {
-        shader.setUniform("u_backbuffer", buffer.dst, index);
+        shader.setUniform("u_backbuffer", _scene.buffer.dst, index);
     }
 
-    vbo->draw(&shader);
-
-    if (shader.needBackbuffer()) {
-        buffer.src->unbind();
-        buffer_shader.use();
-        buffer_shader.setUniform("u_resolution",getWindowWidth(), getWindowHeight());
-        buffer_shader.setUniform("u_modelViewProjectionMatrix", mvp);
-        buffer_shader.setUniform("u_buffer", buffer.src, index++);
-        buffer_vbo->draw(&buffer_shader);
+    if (_scene.vbo->numLods() > 1) {
+        _scene.vbo->setLod( selectLod(_scene) );
     }
 
-    if (screenshotFile != "") {
-        screenshot(screenshotFile);
-        screenshotFile = "";
+    _scene.vbo->draw(&shader);
+
+    if (offscreen) {
+        _scene.buffer.src->unbind();
     }
-    inspect->draw_gui(&draw_inspect);
 }
 
-// Rendering Thread
-//============================================================================
-void onFileChange(int index) {
-    std::string type = files[index].type;
-    std::string path = files[index].path;
-
-    if (type == "fragment") {
-        fragSource = "";
-        if (loadFromPath(path, &fragSource, include_folders)) {
-            shader.detach(GL_FRAGMENT_SHADER | GL_VERTEX_SHADER);
-            shader.load(fragSource, vertSource, defines, verbose);
-        }
+//  Add what the main pass of _scene rendered offscreen to the accumulation (when on) and show it
+void presentScene(Scene& _scene) {
+    if (isConverged(_scene)) {
+        showBuffer(&_scene.accumulation, _scene.viewport);
     }
-    else if (type == "vertex") {
-        vertSource = "";
-        if (loadFromPath(path, &vertSource, include_folders)) {
-            shader.detach(GL_FRAGMENT_SHADER | GL_VERTEX_SHADER);
-            shader.load(fragSource, vertSource, defines, verbose);
-        }
+    else if (accumulate) {
+        // The new sample weighs 1/(n+1) of the average, so the first one replaces what was there
+        _scene.accumulation.bind(_scene.sampleIndex == 0? FBO_LOAD_CLEAR : FBO_LOAD_PRESERVE);
+        glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+        glBlendColor(0.0, 0.0, 0.0, 1.0 / (_scene.sampleIndex + 1));
+        buffer_shader.use();
+        buffer_shader.setUniform("u_modelViewProjectionMatrix", glm::mat4(1.));
+        buffer_shader.setUniform("u_buffer", _scene.buffer.src, 0);
+        buffer_vbo->draw(&buffer_shader);
+        glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+        _scene.accumulation.unbind();
+        _scene.sampleIndex++;
+
+        showBuffer(&_scene.accumulation, _scene.viewport);
     }
-    else if (type == "geometry") {
-        // TODO
+    else if (isOffscreen(_scene)) {
+        showBuffer(_scene.buffer.src, _scene.viewport);
     }
-    else if (type == "image") {
-        for (std::map<std::string,Texture*>::iterator it = textures.begin(); it!=textures.end(); ++it) {
-            if (path == it->second->getFilePath()) {
-                it->second->load(path, files[index].vFlip);
-                break;
+}
+
+//  Add the GPU times that arrived to the stats (and the trace), true if one of the main pass did
+bool collectGpuTimes() {
+    bool main = false;
+    bool any = false;
+    double total = 0.0;
+    for (int i = 0; i < GPU_PASS_TOTAL; i++) {
+        double milliseconds = 0.0;
+        std::chrono::steady_clock::time_point begin;
+        if (gpuTimers[i].getResult(milliseconds, begin)) {
+            traceTrackZone("GPU", gpuPassNames[i], begin, milliseconds);
+            gpuTimes[i] = milliseconds;
+            frameStats.add(gpuSections[i], milliseconds);
+            total += milliseconds;
+            any = true;
+            main = main || i == GPU_PASS_MAIN;
+
+            // The time of a single scene is the time of its shader, once the results of the
+            // frames before it was loaded are out of the way
+            if (i == GPU_PASS_MAIN && scenes.size() == 1 && scenes[0]->shaderFrames > GPU_TIMER_QUERIES) {
+                scenes[0]->shaderGpuTime += milliseconds;
+                scenes[0]->shaderGpuFrames++;
             }
         }
     }
-}
 
-void onKeyPress(int _key) {
-    if (_key == 's' || _key == 'S') {
-        screenshot(outputFile);
+    // The results of the passes of a frame arrive together
+    if (any) {
+        frameStats.add(statGpuFrame, total);
     }
+    return main;
+}
 
-    if (_key == 'q' || _key == 'Q') {
-        bRun = false;
-        bRun.store(false);
+//  Show (and upsample) what was rendered offscreen in the _viewport of the window, through a
+//  billboard where it can't be blitted
+void showBuffer(Fbo* _fbo, const glm::ivec4& _viewport) {
+    if (!_fbo->blit(0, _viewport.z, _viewport.w, _viewport.x, _viewport.y)) {
+        glViewport(_viewport.x, _viewport.y, _viewport.z, _viewport.w);
+        buffer_shader.use();
+        buffer_shader.setUniform("u_modelViewProjectionMatrix", glm::mat4(1.));
+        buffer_shader.setUniform("u_buffer", _fbo, 0);
+        buffer_vbo->draw(&buffer_shader);
+        glViewport(0, 0, getWindowWidth(), getWindowHeight());
     }
 }
 
-void onMouseMove(float _x, float _y) {
-
-}
+//  Uniforms shared by the main pass and the buffers of _scene, for a target of _width x _height
+//  pixels (mouse coordinates are made relative to the scene and scaled to it). Returns the next
+//  free texture unit
+unsigned int setCommonUniforms(Scene& _scene, Shader& _shader, int _width, int _height) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    glm::vec2 offset = glm::vec2(_scene.viewport.x, _scene.viewport.y);
+    glm::vec2 scale = glm::vec2(float(_width) / _scene.viewport.z, float(_height) / _scene.viewport.w);
+
+    _shader.setUniform("u_resolution", _width, _height);
+    _shader.setUniform("u_frame", frameIndex);
+    _shader.setUniform("u_sampleIndex", _scene.sampleIndex);
+    if (_shader.needTime()) {
+        _shader.setUniform("u_time", float(fixedTime >= 0.0? fixedTime : getTime()));
+    }
+    if (_shader.needDelta()) {
+        _shader.setUniform("u_delta", float(getDelta()));
+    }
+    if (_shader.needDate()) {
+        _shader.setUniform("u_date", getDate());
+    }
+    if (_shader.needMouse()) {
+        _shader.setUniform("u_mouse", (getMousePosition() - offset) * scale);
+    }
+    if (_shader.need_iMouse()) {
+        _shader.setUniform("iMouse", (get_iMouse() - glm::vec4(offset, offset)) * glm::vec4(scale, scale));
+    }
+    if (_shader.needView2d()) {
+        _shader.setUniform("u_view2d", u_view2d);
+    }
+    if (_shader.needView3d()) {
+        _shader.setUniform("u_eye3d", u_eye3d);
+        _shader.setUniform("u_centre3d", u_centre3d);
+        _shader.setUniform("u_up3d", u_up3d);
+    }
 
-void onMouseClick(float _x, float _y, int _button) {
+    for (UniformList::iterator it=_scene.uniforms.begin(); it!=_scene.uniforms.end(); ++it) {
+        if (it->second.bInt) {
+            _shader.setUniform(it->first.c_str(), int(it->second.value[0]));
+        }
+        else {
+            _shader.setUniform(it->first.c_str(), it->second.value, it->second.size);
+        }
+    }
+
+    // Pass Textures Uniforms. The name of their resolution is built in a string that keeps its
+    // memory from one call to the next
+    static std::string resolution;
+    unsigned int index = 0;
+    for (std::map<std::string,Texture*>::iterator it = _scene.textures.begin(); it!=_scene.textures.end(); ++it) {
+        _shader.setUniform(it->first.c_str(), it->second, index);
+        resolution.assign(it->first).append("Resolution");
+        _shader.setUniform(resolution.c_str(), it->second->getWidth(), it->second->getHeight());
+        index++;
+    }
+
+    uniformsTime += FrameStats::since(start);
+    return index;
+}
+
+//  Compiled shader for these sources, shared with the scenes that already use the same ones.
+//  The ones no scene uses anymore are dropped
+std::shared_ptr<Shader> loadShader(const std::string& _fragSource, const std::string& _vertSource) {
+    std::string key = _fragSource + '\0' + _vertSource + (heatmap? std::string("\0heatmap", 8) : std::string());
+    std::map<std::string, std::shared_ptr<Shader> >::iterator it = shaderCache.find(key);
+    if (it != shaderCache.end()) {
+        return it->second;
+    }
+
+    for (it = shaderCache.begin(); it != shaderCache.end();) {
+        if (it->second.use_count() == 1) {
+            it = shaderCache.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    std::vector<std::string> shaderDefines = defines;
+    if (heatmap) {
+        shaderDefines.push_back(SHADER_HEATMAP_DEFINE);
+    }
+
+    std::shared_ptr<Shader> shader = std::make_shared<Shader>();
+    if (shader->load(_fragSource, _vertSource, shaderDefines, verbose)) {
+        shaderCache[key] = shader;
+    }
+    return shader;
+}
+
+//  Texture of the image at _path, loaded (and watched) the first time a scene asks for it
+Texture* loadTexture(const std::string& _path) {
+    std::map<std::string,Texture*>::iterator it = textureCache.find(_path);
+    if (it != textureCache.end()) {
+        return it->second;
+    }
+
+    struct stat st;
+    if (stat(_path.c_str(), &st) != 0) {
+        std::cerr << "Error watching file " << _path << std::endl;
+        return nullptr;
+    }
+
+    Texture* tex = new Texture();
+    if (!tex->load(_path, vFlip)) {
+        delete tex;
+        return nullptr;
+    }
+    textureCache[_path] = tex;
+
+    WatchFile file;
+    file.type = "image";
+    file.path = _path;
+    file.lastChange = st.st_mtime;
+    file.vFlip = vFlip;
+    file.scene = -1;
+    files.push_back(file);
+    return tex;
+}
+
+//  Compile the main shader of _scene and the passes of its buffers again
+void reloadShaders(Scene& _scene) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    _scene.shader = loadShader(_scene.fragSource, _scene.vertSource);
+    _scene.shaderFrames = 0;
+    _scene.shaderGpuFrames = 0;
+    _scene.shaderGpuTime = 0.0;
+    _scene.renderGraph.load(_scene.fragSource, bufferVertSource, defines, verbose);
+    allocateMainTarget(_scene);
+    resetAccumulation(_scene);
+    reloadTime = FrameStats::since(start);
+}
+
+//  JSON of the statistics of the main shader of _scene
+std::string getShaderStats(Scene& _scene) {
+    std::string key = _scene.fragSource + '\0' + _scene.vertSource;
+    for (size_t i = 0; i < defines.size(); i++) {
+        key += '\0' + defines[i];
+    }
+
+    const ShaderStats& stats = _scene.shader->getStats();
+    std::stringstream json;
+    json << "{\"hash\":\"" << getHash(key) << "\"";
+    json << ",\"compile_ms\":" << stats.compileTime;
+    json << ",\"link_ms\":" << stats.linkTime;
+    json << ",\"binary_size\":" << stats.binarySize;
+    json << ",\"instructions\":" << stats.instructions;
+    json << ",\"texture_fetches\":" << stats.textureFetches;
+    json << ",\"uniforms\":" << stats.uniforms;
+    json << ",\"samplers\":" << stats.samplers;
+
+    json << ",\"ns_per_pixel\":";
+    if (_scene.shaderGpuFrames > 0) {
+        bool offscreen = isOffscreen(_scene);
+        double width = offscreen? _scene.buffer.src->getWidth() : getWindowWidth();
+        double height = offscreen? _scene.buffer.src->getHeight() : getWindowHeight();
+        json << _scene.shaderGpuTime / _scene.shaderGpuFrames * 1e6 / (width * height);
+    }
+    else {
+        json << "null";
+    }
+    json << "}";
+    return json.str();
+}
+
+//  Append the statistics of the main shader of _scene, and when they were taken, to the
+//  .stats.jsonl file next to it
+bool logShaderStats(Scene& _scene) {
+    if (_scene.iFrag == -1) {
+        return false;
+    }
+
+    std::string path = files[_scene.iFrag].path + ".stats.jsonl";
+    std::ofstream file(path.c_str(), std::ios::app);
+    if (!file.is_open()) {
+        std::cerr << "can't open file " << path << std::endl;
+        return false;
+    }
+
+    std::string stats = getShaderStats(_scene);
+    file << "{\"time\":" << (long long)std::time(nullptr) << "," << stats.substr(1) << std::endl;
+    return file.good();
+}
+
+//  Compile the main shaders of all the scenes with the loop counters of the heatmap, or without
+void setHeatmap(bool _on) {
+    if (heatmap == _on) {
+        return;
+    }
+    heatmap = _on;
+    for (size_t i = 0; i < scenes.size(); i++) {
+        reloadShaders(*scenes[i]);
+    }
+}
+
+//  Render the main pass of _scene once with the raw loop counts of the heatmap, read them back
+//  and return their histogram as JSON: HEATMAP_BINS bins up to heatmapMax (the last one also
+//  has what is over it) and the percentiles of the counts
+std::string getHeatmapHistogram(Scene& _scene) {
+    TRACE_ZONE("heatmap histogram");
+    bool offscreen = isOffscreen(_scene);
+    glm::ivec4 rect = _scene.viewport;
+    if (offscreen) {
+        rect = glm::ivec4(0, 0, _scene.buffer.src->getWidth(), _scene.buffer.src->getHeight());
+    }
+
+    std::vector<unsigned char> pixels(rect.z * rect.w * 4);
+    heatmapRaw = true;
+    renderMain(_scene);
+    heatmapRaw = false;
+
+    if (offscreen) {
+        _scene.buffer.src->bind(FBO_LOAD_PRESERVE);
+    }
+    glReadPixels(rect.x, rect.y, rect.z, rect.w, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    if (offscreen) {
+        _scene.buffer.src->unbind();
+        // What the frame renders next is still on top of the last one it rendered
+        _scene.buffer.swap();
+    }
+    else {
+        // The frame draws in the window after it, at the same depth, that would reject all of it
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    size_t total = rect.z * rect.w;
+    std::vector<size_t> counts(65536, 0);
+    double sum = 0.0;
+    for (size_t i = 0; i < total; i++) {
+        int cost = pixels[i * 4] + 256 * pixels[i * 4 + 1];
+        counts[cost]++;
+        sum += cost;
+    }
+
+    std::vector<size_t> bins(HEATMAP_BINS, 0);
+    int percentiles[3] = { -1, -1, -1 };
+    const double ranks[3] = { 0.5, 0.9, 0.99 };
+    int maximum = 0;
+    size_t seen = 0;
+    for (size_t cost = 0; cost < counts.size(); cost++) {
+        if (counts[cost] == 0) {
+            continue;
+        }
+        bins[std::min(int(cost * HEATMAP_BINS / heatmapMax), HEATMAP_BINS - 1)] += counts[cost];
+        seen += counts[cost];
+        for (int p = 0; p < 3; p++) {
+            if (percentiles[p] == -1 && seen > ranks[p] * (total - 1)) {
+                percentiles[p] = cost;
+            }
+        }
+        maximum = cost;
+    }
+
+    std::stringstream json;
+    json << "{\"pixels\":" << total;
+    json << ",\"mean\":" << (total > 0? sum / total : 0.0);
+    json << ",\"p50\":" << percentiles[0];
+    json << ",\"p90\":" << percentiles[1];
+    json << ",\"p99\":" << percentiles[2];
+    json << ",\"max\":" << maximum;
+    json << ",\"bin_width\":" << heatmapMax / HEATMAP_BINS;
+    json << ",\"bins\":[";
+    for (int i = 0; i < HEATMAP_BINS; i++) {
+        json << (i > 0? "," : "") << bins[i];
+    }
+    json << "]}";
+    return json.str();
+}
+
+//  Split a window of _width x _height in a grid of (about square) cells, one per scene
+void layoutScenes(int _width, int _height) {
+    // The window is made before the scenes
+    if (scenes.empty()) {
+        return;
+    }
+
+    int cols = ceil(sqrt(double(scenes.size())));
+    int rows = (scenes.size() + cols - 1) / cols;
+    int width = _width / cols;
+    int height = _height / rows;
+
+    // The first scene goes on the top left corner, where gl_FragCoord.y is highest
+    for (size_t i = 0; i < scenes.size(); i++) {
+        int col = i % cols;
+        int row = i / cols;
+        scenes[i]->viewport = glm::ivec4(col * width, _height - (row + 1) * height, width, height);
+    }
+    cam.setViewport(width, height);
+}
+
+//  (Re)allocate the backbuffer of _scene in the format and resolution its main pass asks for
+void allocateMainTarget(Scene& _scene) {
+    BufferOptions target = getBufferOptions(_scene.fragSource, "main", mainOptions);
+    target = getBufferOptions(_scene.fragSource, "u_backbuffer", target);
+    if (targetFps > 0.0) {
+        target.scale = dynamicScale;
+    }
+    // Samples are kept in half floats at least, so the average isn't quantized twice
+    if (accumulate && target.format == FBO_RGBA8) {
+        target.format = FBO_RGBA16F;
+    }
+
+    int width = target.getScaled(_scene.viewport.z);
+    int height = target.getScaled(_scene.viewport.w);
+    bool allocated = _scene.buffer.src != nullptr && width == (int)_scene.buffer.src->getWidth() && height == (int)_scene.buffer.src->getHeight() && target.format == _scene.mainTarget.format;
+
+    _scene.mainTarget = target;
+    if (!allocated) {
+        _scene.buffer.allocate(width, height, _scene.iGeom != -1, _scene.mainTarget.format);
+    }
+
+    if (accumulate && (width != (int)_scene.accumulation.getWidth() || height != (int)_scene.accumulation.getHeight())) {
+        _scene.accumulation.allocate(width, height, false, FBO_RGBA32F);
+        resetAccumulation(_scene);
+    }
+}
+
+//  Start averaging the samples of _scene again, from the next frame
+void resetAccumulation(Scene& _scene) {
+    _scene.accumulationReset = true;
+    requestRedraw();
+}
+
+//  Same for all the scenes, when something they share (like the camera) changes
+void resetAccumulation() {
+    for (size_t i = 0; i < scenes.size(); i++) {
+        resetAccumulation(*scenes[i]);
+    }
+}
+
+//  Something changed, draw it. ImGui reacts to the input a
+//  frame later, so two are drawn
+void requestRedraw() {
+    redrawFrames = 2;
+    frameChanged = true;
+    if (onDemand) {
+        wakeGL();
+    }
+}
+
+//  The next frame wouldn't be the same as the last one
+bool needsFrame() {
+    if (redrawFrames > 0 || screenshotFile != "" || !bRun.load()) {
+        return true;
+    }
+
+    for (size_t i = 0; i < scenes.size(); i++) {
+        const Scene& scene = *scenes[i];
+        const Shader& shader = *scene.shader;
+
+        // Animated, by the uniforms they read or by feeding back on themselves
+        if (shader.needTime() || shader.needDelta() || shader.needDate() || shader.hasUniform("u_frame") ||
+            shader.needBackbuffer() || scene.mainTarget.load == FBO_LOAD_PRESERVE || scene.renderGraph.isAnimated()) {
+            return true;
+        }
+
+        // Still accumulating samples
+        if (accumulate && (accumulateLimit == 0 || scene.sampleIndex < accumulateLimit || scene.accumulationReset)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//  Keep track of the latency of the frame that read its input at _inputTime, or of an earlier
+//  one when they are measured with fences
+void updateLatency(std::chrono::steady_clock::time_point _inputTime) {
+    double frameLatency = 0.0;
+    if (FrameFences::isSupported()) {
+        frameFences.insert(_inputTime);
+        if (!frameFences.getLatency(frameLatency)) {
+            return;
+        }
+    }
+    else {
+        frameLatency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _inputTime).count();
+    }
+
+    latency = frameLatency;
+    latencyAverage = (latencyAverage == 0.0)? latency : latencyAverage * 0.9 + latency * 0.1;
+}
+
+//  Hold the frame until its turn comes with --max-fps. Sleeps wake up late by up to a
+//  millisecond or two, so the last FRAME_SPIN_TIME seconds are spun
+void limitFrameRate() {
+    static std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxFps));
+
+    // Running late (or back from idling) the count starts again, instead of rushing the next frames
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (next < now) {
+        next = now;
+        return;
+    }
+
+    std::chrono::duration<double> sleep = next - now - std::chrono::duration<double>(FRAME_SPIN_TIME);
+    if (sleep.count() > 0.0) {
+        std::this_thread::sleep_for(sleep);
+    }
+    while (std::chrono::steady_clock::now() < next) {
+        std::this_thread::yield();
+    }
+}
+
+//  Sleep (processing the input events and the ones of the watchers) until there is a new frame to draw or _timeout seconds
+//  have passed (no limit if negative), and keep track of the time spent waiting
+void waitForChanges(double _timeout) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double waited = 0.0;
+    processEvents();
+    while (!needsFrame() && isGL() && (_timeout < 0.0 || waited < _timeout)) {
+        double timeout = IDLE_WAIT_MAX;
+        if (_timeout >= 0.0 && _timeout - waited < timeout) {
+            timeout = _timeout - waited;
+        }
+        waitGL(timeout);
+        processEvents();
+        waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    idleTime += waited;
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - idleStatsStart).count();
+    if (elapsed >= 1.0) {
+        idlePercent = 100.0 * idleTime / elapsed;
+        idleTime = 0.0;
+        idleStatsStart = std::chrono::steady_clock::now();
+    }
+}
+
+//  Move the scale of the main pass towards the one that renders in the time of --target-fps
+void updateDynamicScale(double _frameTime) {
+    frameTimeAverage = (frameTimeAverage == 0.0)? _frameTime : frameTimeAverage * 0.9 + _frameTime * 0.1;
+    if (getTime() - dynamicScaleTime < 0.25) {
+        return;
+    }
+
+    // The cost goes with the number of pixels, the square of the scale. Aim a bit under
+    // the budget, drop right away when over it and climb back one step at a time
+    double budget = 1000.0 / targetFps;
+    float ideal = dynamicScale * sqrt(budget * 0.9 / frameTimeAverage);
+    float scale = dynamicScale;
+    if (frameTimeAverage > budget) {
+        scale = floor(ideal / DYNAMIC_SCALE_STEP) * DYNAMIC_SCALE_STEP;
+    }
+    else if (ideal >= dynamicScale + DYNAMIC_SCALE_STEP) {
+        scale = dynamicScale + DYNAMIC_SCALE_STEP;
+    }
+    if (scale < DYNAMIC_SCALE_MIN) {
+        scale = DYNAMIC_SCALE_MIN;
+    }
+    else if (scale > 1.0) {
+        scale = 1.0;
+    }
 
+    if (scale != dynamicScale) {
+        frameTimeAverage *= (scale * scale) / (dynamicScale * dynamicScale);
+        dynamicScale = scale;
+        dynamicScaleTime = getTime();
+        for (size_t i = 0; i < scenes.size(); i++) {
+            allocateMainTarget(*scenes[i]);
+        }
+        requestRedraw();
+    }
+}
+
+// Rendering Thread
+//============================================================================
+bool loadGeometry(Scene& _scene, const std::string& _path) {
+    glm::vec3 toCentroid, min, max;
+    MeshCache cache;
+
+    uint32_t cacheFlags = 0;
+    if (optimizeMesh) {
+        cacheFlags |= MESHCACHE_OPTIMIZED;
+    }
+    if (optimizeMeshOverdraw) {
+        cacheFlags |= MESHCACHE_OVERDRAW;
+    }
+    if (useLods) {
+        cacheFlags |= MESHCACHE_LODS;
+    }
+
+    if (haveExt(_path,"glsv")) {
+        if (!cache.open(_path)) {
+            std::cerr << "Error loading mesh cache " << _path << std::endl;
+            return false;
+        }
+    }
+    else if (useMeshCache) {
+        std::string cachePath = MeshCache::getCachePath(_path);
+        if (cache.open(cachePath) &&
+            (!cache.isUpToDate(_path) || (cache.getHeader().flags & MESHCACHE_PASSES) != cacheFlags)) {
+            cache.close();
+        }
+    }
+
+    if (cache.isOpen()) {
+        if (_scene.vbo) {
+            delete _scene.vbo;
+        }
+        _scene.vbo = cache.getVbo();
+        toCentroid = cache.getCentroid();
+
+        const MeshCacheHeader& header = cache.getHeader();
+        min = glm::vec3(header.min[0], header.min[1], header.min[2]);
+        max = glm::vec3(header.max[0], header.max[1], header.max[2]);
+    }
+    else {
+        Mesh model;
+        if (!model.load(_path)) {
+            return false;
+        }
+
+        if (optimizeMesh) {
+            float acmr = getACMR(model.getIndices(), model.getVertices().size());
+            if (model.optimize(optimizeMeshOverdraw)) {
+                std::cout << "// Mesh optimized, ACMR " << acmr << " -> " << getACMR(model.getIndices(), model.getVertices().size()) << std::endl;
+            }
+        }
+
+        if (useLods && model.generateLods()) {
+            std::cout << "// Levels of detail: " << model.getIndices().size() / 3;
+            for (size_t l = 0; l < model.getLods().size(); l++) {
+                std::cout << ", " << model.getLods()[l].size() / 3;
+            }
+            std::cout << " triangles" << std::endl;
+        }
+
+        if (_scene.vbo) {
+            delete _scene.vbo;
+        }
+        _scene.vbo = model.getVbo();
+        GeomBounds bounds = computeBounds(model.getVertices());
+        toCentroid = bounds.centroid;
+        min = bounds.min;
+        max = bounds.max;
+
+        if (useMeshCache) {
+            std::string cachePath = MeshCache::getCachePath(_path);
+            if (MeshCache::save(cachePath, model, _path, cacheFlags)) {
+                std::cout << "// Mesh cache saved to " << cachePath << std::endl;
+            }
+        }
+    }
+
+    // model_matrix = glm::scale(glm::vec3(0.001));
+    _scene.model_matrix = glm::translate(-toCentroid);
+    _scene.model_center = (min + max) * 0.5f;
+    _scene.model_radius = glm::length(max - min) * 0.5f;
+    return true;
+}
+
+//  Coarsest level of detail that still has about one triangle every LOD_PIXELS_PER_TRIANGLE
+//  pixels of the screen area covered by the geometry's bounding sphere in _scene
+int selectLod(Scene& _scene) {
+    const glm::mat4& projection = cam.getProjectionMatrix();
+    glm::vec4 center = cam.getProjectionViewMatrix() * _scene.model_matrix * glm::vec4(_scene.model_center, 1.0);
+
+    // Perspective projections divide by the distance, orthographic ones don't
+    float w = 1.0;
+    if (projection[3][3] == 0.0) {
+        if (center.w <= _scene.model_radius) {
+            return 0;
+        }
+        w = center.w;
+    }
+
+    float radius = _scene.model_radius * projection[1][1] / w * _scene.viewport.w * 0.5;
+    float area = PI * radius * radius;
+
+    // Front and back facing triangles overlap on screen
+    float triangles = 2.0 * area / LOD_PIXELS_PER_TRIANGLE;
+
+    for (int lod = _scene.vbo->numLods() - 1; lod > 0; lod--) {
+        if (_scene.vbo->numLodIndices(lod) / 3 >= triangles) {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+//  Handle what the watcher threads sent since the last time, false if there was nothing
+bool processEvents() {
+    static std::vector<Event> pending;
+    if (!events.popAll(pending)) {
+        return false;
+    }
+    frameChanged = true;
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (pending[i].type == EVENT_FILE_CHANGED) {
+            onFileChange(pending[i].file);
+        }
+        else if (pending[i].type == EVENT_COMMAND) {
+            replies.push(runCommand(pending[i].line));
+        }
+    }
+    pending.clear();
+    return true;
+}
+
+//  Run a console command, returns what to print back. Commands about a scene go to the
+//  first one unless they start with the number of another
+std::string runCommand(const std::string& _command) {
+    std::stringstream rta;
+
+    std::string line = _command;
+    size_t id = 0;
+    size_t space = _command.find(' ');
+    if (space != std::string::npos && space > 0 && _command.find_first_not_of("0123456789") == space) {
+        id = toInt(_command.substr(0, space));
+        line = _command.substr(space + 1);
+    }
+    if (id >= scenes.size()) {
+        rta << "// There is no scene " << id << std::endl;
+        return rta.str();
+    }
+    Scene& scene = *scenes[id];
+
+    if (line == "q" || line == "quit" || line == "exit") {
+        bRun.store(false);
+    }
+    else if (line == "fps") {
+        rta << std::fixed << getFPS() << std::endl;
+    }
+    else if (line == "delta") {
+        rta << std::fixed << getDelta() << std::endl;
+    }
+    else if (line == "time") {
+        rta << std::fixed << getTime() << std::endl;
+    }
+    else if (line == "date") {
+        glm::vec4 date = getDate();
+        rta << date.x << ',' << date.y << ',' << date.z << ',' << date.w << std::endl;
+    }
+    else if (line == "window_width") {
+        rta << getWindowWidth() << std::endl;
+    }
+    else if (line == "window_height") {
+        rta << getWindowHeight() << std::endl;
+    }
+    else if (line == "pixel_density") {
+        rta << getPixelDensity() << std::endl;
+    }
+    else if (line == "screen_size") {
+        glm::ivec2 screen_size = getScreenSize();
+        rta << screen_size.x << ',' << screen_size.y << std::endl;
+    }
+    else if (line == "viewport") {
+        glm::ivec4 viewport = getViewport();
+        rta << viewport.x << ',' << viewport.y << ',' << viewport.z << ',' << viewport.w << std::endl;
+    }
+    else if (line == "mouse_x") {
+        rta << getMouseX() << std::endl;
+    }
+    else if (line == "mouse_y") {
+        rta << getMouseY() << std::endl;
+    }
+    else if (line == "mouse") {
+        glm::vec2 pos = getMousePosition();
+        rta << pos.x << "," << pos.y << std::endl;
+    }
+    else if (line == "view3d") {
+        rta << "eye=("
+                << u_eye3d.x << "," << u_eye3d.y << "," << u_eye3d.z << ") "
+            << "centre=("
+                << u_centre3d.x << "," << u_centre3d.y << ","
+                << u_centre3d.z << ") "
+            << "up=("
+                << u_up3d.x << "," << u_up3d.y << "," << u_up3d.z << ")"
+            << std::endl;
+    }
+    else if (line == "lod") {
+        rta << scene.vbo->getLod() << std::endl;
+    }
+    else if (line == "latency") {
+        rta << latency << ',' << latencyAverage << std::endl;
+    }
+    else if (line == "shader_stats") {
+        rta << getShaderStats(scene) << std::endl;
+    }
+    else if (line == "heatmap") {
+        rta << (heatmap? "on" : "off") << ',' << heatmapMax << std::endl;
+    }
+    else if (beginsWith(line, "heatmap ")) {
+        std::vector<std::string> values = split(line,' ');
+        if (values.size() == 2 && (values[1] == "on" || values[1] == "off")) {
+            setHeatmap(values[1] == "on");
+        }
+        else if (values.size() == 2 && toFloat(values[1]) > 0.0) {
+            heatmapMax = toFloat(values[1]);
+            setHeatmap(true);
+        }
+        else {
+            rta << "// Use heatmap on, heatmap off or heatmap <max>" << std::endl;
+        }
+    }
+    else if (line == "heatmap_histogram") {
+        if (heatmap) {
+            rta << getHeatmapHistogram(scene) << std::endl;
+        }
+        else {
+            rta << "// The heatmap is off" << std::endl;
+        }
+    }
+    else if (line == "gl_calls") {
+        if (glCallsAvailable()) {
+            rta << glCallsReport() << std::endl;
+        }
+        else {
+            rta << "// GL calls are only counted when built with GL_CALL_COUNTING" << std::endl;
+        }
+    }
+    else if (line == "overlay") {
+        rta << (drawPerfOverlay? "on" : "off") << std::endl;
+    }
+    else if (line == "overlay on" || line == "overlay off") {
+        drawPerfOverlay = (line == "overlay on");
+        requestRedraw();
+    }
+    else if (line == "stats") {
+        rta << frameStats.toJson() << std::endl;
+    }
+    else if (line == "idle") {
+        rta << idlePercent << std::endl;
+    }
+    else if (line == "scale") {
+        rta << scene.mainTarget.scale << std::endl;
+    }
+    else if (line == "samples") {
+        rta << scene.sampleIndex << std::endl;
+    }
+    else if (line == "frag") {
+        rta << scene.fragSource << std::endl;
+    }
+    else if (line == "vert") {
+        rta << scene.vertSource << std::endl;
+    }
+    else if (beginsWith(line, "screenshot")) {
+        if (line == "screenshot" && outputFile != "") {
+            screenshotFile = outputFile;
+        }
+        else {
+            std::vector<std::string> values = split(line,' ');
+            if (values.size() == 2) {
+                screenshotFile = values[1];
+            }
+        }
+        // Only the scene the command was for, if it said which
+        screenshotScene = (line != _command)? id : -1;
+        requestRedraw();
+    }
+    else if (parseUniforms(line, &scene.uniforms)) {
+        resetAccumulation(scene);
+    }
+
+    return rta.str();
+}
+
+void onFileChange(int index) {
+    TRACE_ZONE("onFileChange");
+    requestRedraw();
+
+    std::string type = files[index].type;
+    std::string path = files[index].path;
+
+    // Images are shared by the scenes that use them
+    if (type == "image") {
+        std::map<std::string,Texture*>::iterator it = textureCache.find(path);
+        if (it != textureCache.end()) {
+            it->second->load(path, files[index].vFlip);
+            resetAccumulation();
+        }
+        return;
+    }
+
+    Scene& scene = *scenes[files[index].scene];
+    if (type == "fragment") {
+        scene.fragSource = "";
+        if (loadFromPath(path, &scene.fragSource, include_folders)) {
+            reloadShaders(scene);
+        }
+    }
+    else if (type == "vertex") {
+        scene.vertSource = "";
+        if (loadFromPath(path, &scene.vertSource, include_folders)) {
+            reloadShaders(scene);
+        }
+    }
+    else if (type == "geometry") {
+        if (loadGeometry(scene, path)) {
+            resetAccumulation(scene);
+            // Default shaders depend on the vertex layout of the geometry
+            if (scene.iFrag == -1 || scene.iVert == -1) {
+                if (scene.iFrag == -1) {
+                    scene.fragSource = scene.vbo->getVertexLayout()->getDefaultFragShader();
+                }
+                if (scene.iVert == -1) {
+                    scene.vertSource = scene.vbo->getVertexLayout()->getDefaultVertShader();
+                }
+                reloadShaders(scene);
+            }
+        }
+    }
+}
+
+void onKeyPress(int _key) {
+    requestRedraw();
+
+    if (_key == 's' || _key == 'S') {
+        screenshot(outputFile);
+    }
+
+    if (_key == 'q' || _key == 'Q') {
+        bRun = false;
+        bRun.store(false);
+    }
+}
+
+void onMouseMove(float _x, float _y) {
+    for (size_t i = 0; i < scenes.size(); i++) {
+        if (scenes[i]->shader->needMouse() || scenes[i]->shader->need_iMouse()) {
+            resetAccumulation(*scenes[i]);
+        }
+    }
+    requestRedraw();
+}
+
+void onMouseClick(float _x, float _y, int _button) {
+    requestRedraw();
 }
 
 void onScroll(float _yoffset) {
+    requestRedraw();
+
     // Vertical scroll button zooms u_view2d and view3d.
     /* zoomfactor 2^(1/4): 4 scroll wheel clicks to double in size. */
     constexpr float zoomfactor = 1.1892;
@@ -753,10 +2100,14 @@ void onScroll(float _yoffset) {
 
         // zoom view3d
         u_eye3d = u_centre3d + (u_eye3d - u_centre3d)*z;
+
+        resetAccumulation();
     }
 }
 
 void onMouseDrag(float _x, float _y, int _button) {
+    requestRedraw();
+
     if (_button == 1){
         // Left-button drag is used to rotate geometry.
         float dist = glm::length(cam.getPosition());
@@ -808,18 +2159,389 @@ void onMouseDrag(float _x, float _y, int _button) {
         u_centre3d += hoff;
         u_eye3d += hoff;
     }
+
+    resetAccumulation();
 }
 
 void onViewportResize(int _newWidth, int _newHeight) {
-    cam.setViewport(_newWidth,_newHeight);
-    buffer.allocate(_newWidth,_newHeight);
+    layoutScenes(_newWidth, _newHeight);
+    resizeSize = glm::ivec2(_newWidth,_newHeight);
+    resizeTime = getTime();
+    requestRedraw();
 }
 
-void screenshot(std::string _file) {
+//  Render the main shader at _width x _height in tiles that fit in a buffer, reading each one
+//  back while the next renders and saving them to _file a row of tiles at a time
+bool renderTiles(Scene& _scene, const std::string& _file, int _width, int _height) {
+    // gl_FragCoord is offset to where the tile is in the whole image
+    std::string tileSource = "#if defined(GL_ES) && defined(GL_FRAGMENT_PRECISION_HIGH)\n\
+uniform highp vec2 u_tileOffset;\n\
+#elif defined(GL_ES)\n\
+uniform mediump vec2 u_tileOffset;\n\
+#else\n\
+uniform vec2 u_tileOffset;\n\
+#endif\n\
+#define gl_FragCoord vec4(gl_FragCoord.xy + u_tileOffset, gl_FragCoord.zw)\n\
+#line 1\n";
+
+    Shader tileShader;
+    if (!tileShader.load(tileSource + _scene.fragSource, _scene.vertSource, defines, verbose)) {
+        return false;
+    }
+    if (_scene.renderGraph.size() > 0 || tileShader.needBackbuffer()) {
+        std::cerr << "Shaders with buffers (u_bufferN or u_backbuffer) can't be rendered in tiles" << std::endl;
+        return false;
+    }
+
+    GLint maxTexture = 0, maxViewport[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    int tile = std::min(TILE_RENDER_SIZE, std::min((int)maxTexture, std::min((int)maxViewport[0], (int)maxViewport[1])));
+
+    Fbo fbo;
+    fbo.allocate(tile, tile, _scene.iGeom != -1);
+
+    PngWriter png;
+    if (!png.open(_file, _width, _height)) {
+        return false;
+    }
+
+    cam.setViewport(_width, _height);
+    _scene.vbo->setLod(0);
+
+    // A row of tiles, top to bottom, as the PNG wants them
+    std::vector<unsigned char> band(_width * tile * 4);
+#ifndef PLATFORM_RPI
+    GLuint pbos[2];
+    glGenBuffers(2, pbos);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, tile * tile * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    int pending = -1;   // tile being read back into pbos[pending % 2]
+#else
+    std::vector<unsigned char> pixels(tile * tile * 4);
+#endif
+
+    int nCols = (_width + tile - 1) / tile;
+    int nRows = (_height + tile - 1) / tile;
+    int nTiles = nCols * nRows;
+    bool success = true;
+
+    // Rows of tiles go from the top, where gl_FragCoord.y is highest
+    auto getRect = [&](int _n) {
+        int row = _n / nCols;
+        int col = _n % nCols;
+        int top = std::min((row + 1) * tile, _height);
+        return glm::ivec4(col * tile, _height - top, std::min(tile, _width - col * tile), top - row * tile);
+    };
+
+    // Copy a tile, read bottom to top, into its place in the band
+    auto copyTile = [&](int _n, const unsigned char* _pixels) {
+        glm::ivec4 rect = getRect(_n);
+        for (int y = 0; y < rect.w; y++) {
+            memcpy(&band[((rect.w - 1 - y) * _width + rect.x) * 4], _pixels + y * rect.z * 4, rect.z * 4);
+        }
+        if (_n % nCols == nCols - 1) {
+            success = png.writeRows(band.data(), rect.w) && success;
+            std::cout << "// Tile row " << (_n / nCols + 1) << " of " << nRows << std::endl;
+        }
+    };
+
+#ifndef PLATFORM_RPI
+    auto collectTile = [&](int _n) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[_n % 2]);
+        const unsigned char* pixels = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels != nullptr) {
+            copyTile(_n, pixels);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else {
+            success = false;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    };
+#endif
+
+    for (int n = 0; n < nTiles && success; n++) {
+        glm::ivec4 rect = getRect(n);
+
+        // Crop the clip space to the part of the image the tile covers
+        float cx = (2.0 * rect.x + rect.z) / _width - 1.0;
+        float cy = (2.0 * rect.y + rect.w) / _height - 1.0;
+        glm::mat4 crop = glm::mat4(1.);
+        crop[0][0] = float(_width) / rect.z;
+        crop[1][1] = float(_height) / rect.w;
+        crop[3][0] = -cx * crop[0][0];
+        crop[3][1] = -cy * crop[1][1];
+
+        fbo.bind();
+        glViewport(0, 0, rect.z, rect.w);
+
+        tileShader.use();
+        setCommonUniforms(_scene, tileShader, _width, _height);
+        tileShader.setUniform("u_tileOffset", float(rect.x), float(rect.y));
+
+        glm::mat4 mvp = crop;
+        if (_scene.iGeom != -1) {
+            tileShader.setUniform("u_eye", -cam.getPosition());
+            tileShader.setUniform("u_normalMatrix", cam.getNormalMatrix());
+
+            tileShader.setUniform("u_modelMatrix", _scene.model_matrix);
+            tileShader.setUniform("u_viewMatrix", cam.getViewMatrix());
+            tileShader.setUniform("u_projectionMatrix", crop * cam.getProjectionMatrix());
+
+            mvp = crop * cam.getProjectionViewMatrix() * _scene.model_matrix;
+        }
+        tileShader.setUniform("u_modelViewProjectionMatrix", mvp);
+
+        _scene.vbo->draw(&tileShader);
+
+#ifndef PLATFORM_RPI
+        // Start reading this tile and collect the one before, which had this one's rendering time to arrive
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[n % 2]);
+        glReadPixels(0, 0, rect.z, rect.w, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        fbo.unbind();
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (pending != -1) {
+            collectTile(pending);
+        }
+        pending = n;
+#else
+        glReadPixels(0, 0, rect.z, rect.w, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        fbo.unbind();
+        copyTile(n, pixels.data());
+#endif
+    }
+
+#ifndef PLATFORM_RPI
+    if (pending != -1 && success) {
+        collectTile(pending);
+    }
+    glDeleteBuffers(2, pbos);
+#endif
+
+    layoutScenes(getWindowWidth(), getWindowHeight());
+    return png.close() && success;
+}
+
+//  Render each variant of the main shader of _scene _frames times, waiting for each frame to
+//  finish, and print the statistics of the frame times as JSON. Frames are timed on the GPU
+//  where there are timer queries, and from the CPU (up to glFinish) otherwise
+bool runBench(Scene& _scene, int _frames) {
+    std::vector<std::string> variants = benchVariants;
+    if (variants.empty()) {
+        variants.push_back("");
+    }
+
+    bool gpu = GpuTimer::isSupported();
+    std::vector<double> times(_frames);
+    bool success = true;
+
+    std::stringstream json;
+    json << "{\"timer\":\"" << (gpu? "gpu" : "cpu") << "\",\"frames\":" << _frames << ",\"variants\":[";
+    for (size_t v = 0; v < variants.size(); v++) {
+        std::vector<std::string> variantDefines = defines;
+        std::vector<std::string> values = split(variants[v], ' ');
+        for (size_t i = 0; i < values.size(); i++) {
+            if (values[i] != "") {
+                variantDefines.push_back(values[i]);
+            }
+        }
+
+        _scene.shader = std::make_shared<Shader>();
+        if (!_scene.shader->load(_scene.fragSource, _scene.vertSource, variantDefines, verbose) ||
+            !_scene.renderGraph.load(_scene.fragSource, bufferVertSource, variantDefines, verbose)) {
+            std::cerr << "The variant \"" << variants[v] << "\" doesn't compile" << std::endl;
+            success = false;
+            continue;
+        }
+
+        timeFrames(_scene, times);
+
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (int n = 0; n < _frames; n++) {
+            mean += sorted[n];
+        }
+        mean /= _frames;
+        double variance = 0.0;
+        for (int n = 0; n < _frames; n++) {
+            variance += (sorted[n] - mean) * (sorted[n] - mean);
+        }
+        double stddev = sqrt(variance / _frames);
+
+        bool offscreen = isOffscreen(_scene);
+        int width = offscreen? _scene.buffer.src->getWidth() : getWindowWidth();
+        int height = offscreen? _scene.buffer.src->getHeight() : getWindowHeight();
+        double median = FrameStats::percentile(sorted, 50.0);
+
+        json << (v == 0? "" : ",") << "\n{\"defines\":\"" << variants[v] << "\"";
+        json << ",\"width\":" << width << ",\"height\":" << height;
+        json << ",\"min\":" << sorted.front();
+        json << ",\"median\":" << median;
+        json << ",\"p95\":" << FrameStats::percentile(sorted, 95.0);
+        json << ",\"p99\":" << FrameStats::percentile(sorted, 99.0);
+        json << ",\"mean\":" << mean;
+        json << ",\"stddev\":" << stddev;
+        json << ",\"ns_per_pixel\":" << median * 1e6 / (double(width) * height);
+        json << "}";
+    }
+    json << "\n]}";
+    std::cout << json.str() << std::endl;
+
+    reloadShaders(_scene);
+    return success;
+}
+
+//  Render the buffers and main pass of _scene offscreen, in fresh buffers and without the averaging
+//  of --accumulate, BENCH_WARMUP_FRAMES times and then one time per measure of _times, waiting for
+//  each frame to finish. The milliseconds are the GPU ones where there are timer queries
+void timeFrames(Scene& _scene, std::vector<double>& _times) {
+    bool gpu = GpuTimer::isSupported();
+    GpuTimer timer;
+
+    allocateMainTarget(_scene);
+    _scene.sampleIndex = 0;
+    for (int n = -BENCH_WARMUP_FRAMES; n < (int)_times.size(); n++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        timer.begin();
+        // As the render loop does. Otherwise the depth of the last frame rejects all of the next one
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderBuffers(_scene);
+        renderMain(_scene);
+        timer.end();
+        glFinish();
+
+        double milliseconds = FrameStats::since(start);
+        if (gpu) {
+            timer.getResult(milliseconds);
+        }
+        if (n >= 0) {
+            _times[n] = milliseconds;
+        }
+        frameIndex++;
+    }
+}
+
+//  Render _scene like runBench does and compare its last frame and median frame time to the ones
+//  of _golden (and _golden.ms), or save them there if there are none yet. Prints the results as
+//  JSON, true if they are within the tolerances
+bool runCompare(Scene& _scene, const std::string& _golden) {
+    if (fixedTime < 0.0) {
+        fixedTime = 0.0;
+    }
+
+    bool gpu = GpuTimer::isSupported();
+    std::vector<double> times(COMPARE_FRAMES);
+    timeFrames(_scene, times);
+    std::sort(times.begin(), times.end());
+    double median = FrameStats::percentile(times, 50.0);
+
+    bool offscreen = isOffscreen(_scene);
+    int width = offscreen? _scene.buffer.src->getWidth() : getWindowWidth();
+    int height = offscreen? _scene.buffer.src->getHeight() : getWindowHeight();
+    std::vector<unsigned char> pixels(width * height * 4);
+    if (offscreen) {
+        _scene.buffer.src->bind(FBO_LOAD_PRESERVE);
+    }
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    if (offscreen) {
+        _scene.buffer.src->unbind();
+    }
+
+    std::stringstream json;
+    json << "{\"golden\":\"" << _golden << "\",\"timer\":\"" << (gpu? "gpu" : "cpu") << "\"";
+    bool success = true;
+
+    std::vector<unsigned char> golden;
+    int goldenWidth, goldenHeight;
+    if (updateGolden) {
+        success = Texture::savePixels(_golden, &pixels[0], width, height);
+        json << ",\"image\":\"" << (success? "saved" : "not saved") << "\"";
+    }
+    else if (!Texture::loadPixels(_golden, golden, goldenWidth, goldenHeight)) {
+        json << ",\"image\":\"missing\"";
+        success = false;
+    }
+    else if (goldenWidth != width || goldenHeight != height) {
+        json << ",\"image\":\"size\",\"width\":" << width << ",\"height\":" << height;
+        json << ",\"golden_width\":" << goldenWidth << ",\"golden_height\":" << goldenHeight;
+        success = false;
+    }
+    else {
+        size_t different = 0;
+        double maximum = 0.0;
+        for (int i = 0; i < width * height; i++) {
+            double difference = getColorDifference(&pixels[i * 4], &golden[i * 4]);
+            if (difference > COMPARE_PIXEL_THRESHOLD) {
+                different++;
+            }
+            maximum = std::max(maximum, difference);
+        }
+        double percent = 100.0 * different / (double(width) * height);
+        success = percent <= compareTolerance;
+        json << ",\"image\":\"" << (success? "pass" : "fail") << "\"";
+        json << ",\"different_pixels\":" << different;
+        json << ",\"different_percent\":" << percent;
+        json << ",\"max_difference\":" << maximum;
+    }
+
+    // Frame times only compare on the machine that recorded them
+    std::string baselinePath = (compareBaseline != "")? compareBaseline : _golden + ".ms";
+    std::ifstream baselineFile(baselinePath.c_str());
+    double baseline = 0.0;
+    json << ",\"median_ms\":" << median;
+    if (!updateGolden && baselineFile >> baseline && baseline > 0.0) {
+        double slowdown = 100.0 * (median / baseline - 1.0);
+        bool fast = slowdown <= compareMaxSlowdown;
+        json << ",\"baseline_ms\":" << baseline << ",\"slowdown_percent\":" << slowdown;
+        json << ",\"time\":\"" << (fast? "pass" : "fail") << "\"";
+        success = success && fast;
+    }
+    else {
+        std::ofstream file(baselinePath.c_str());
+        file << median << std::endl;
+        json << ",\"time\":\"saved\"";
+    }
+    json << "}";
+    std::cout << json.str() << std::endl;
+
+    return success;
+}
+
+//  How different two RGB colors look, from 0 to 1: their distance in YIQ, weighting luma over
+//  chroma the way the eye does (as pixelmatch does it)
+double getColorDifference(const unsigned char* _a, const unsigned char* _b) {
+    double r = _a[0] - _b[0];
+    double g = _a[1] - _b[1];
+    double b = _a[2] - _b[2];
+    double y = r * 0.29889531 + g * 0.58662247 + b * 0.11448223;
+    double i = r * 0.59597799 - g * 0.27417610 - b * 0.32180189;
+    double q = r * 0.21147017 - g * 0.52261711 + b * 0.31114694;
+    // 35215 is the largest the sum gets, between black and white
+    return sqrt((0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q) / 35215.0);
+}
+
+//  Save the window, or only the part of it where _scene is, to _file
+void screenshot(std::string _file, int _scene) {
+    TRACE_ZONE("screenshot");
     if (_file != "" && isGL()) {
-        unsigned char* pixels = new unsigned char[getWindowWidth()*getWindowHeight()*4];
-        glReadPixels(0, 0, getWindowWidth(), getWindowHeight(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-        Texture::savePixels(_file, pixels, getWindowWidth(), getWindowHeight());
+        glm::ivec4 rect = glm::ivec4(0, 0, getWindowWidth(), getWindowHeight());
+        if (_scene >= 0 && _scene < (int)scenes.size()) {
+            rect = scenes[_scene]->viewport;
+        }
+        unsigned char* pixels = new unsigned char[rect.z*rect.w*4];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        gpuTimers[GPU_PASS_READBACK].begin();
+        glReadPixels(rect.x, rect.y, rect.z, rect.w, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        gpuTimers[GPU_PASS_READBACK].end();
+        frameStats.add(statReadback, FrameStats::since(start));
+        Texture::savePixels(_file, pixels, rect.z, rect.w);
         std::cout << "// Screenshot saved to " << _file << std::endl;
     }
 }
@@ -828,6 +2550,12 @@ void onExit() {
     // Take a screenshot if it need
     screenshot(outputFile);
 
+    traceStop();
+
+    if (glCallsOnExit && glCallsAvailable()) {
+        std::cout << glCallsReport() << std::endl;
+    }
+
     // clear screen
     glClear( GL_COLOR_BUFFER_BIT );
 
@@ -835,14 +2563,19 @@ void onExit() {
     closeGL();
 
     // DELETE RESOURCES
-    for (std::map<std::string,Texture*>::iterator i = textures.begin(); i != textures.end(); ++i) {
+    for (size_t i = 0; i < scenes.size(); i++) {
+        delete scenes[i];
+    }
+    scenes.clear();
+    shaderCache.clear();
+
+    for (std::map<std::string,Texture*>::iterator i = textureCache.begin(); i != textureCache.end(); ++i) {
         delete i->second;
         i->second = NULL;
     }
-    textures.clear();
-    delete vbo;
+    textureCache.clear();
 }
 
 void printUsage(char * executableName) {
-    std::cerr << "Usage: " << executableName << " <shader>.frag [<shader>.vert] [<mesh>.(obj/.ply)] [<texture>.(png/jpg)] [-<uniformName> <texture>.(png/jpg)] [-vFlip] [-x <x>] [-y <y>] [-w <width>] [-h <height>] [-l] [--square] [-s/--sec <seconds>] [-o <screenshot_file>.png] [--headless] [-c/--cursor] [-I<include_folder>] [-D<define>] [-v/--verbose] [--help]\n";
+    std::cerr << "Usage: " << executableName << " <shader>.frag [<shader>.vert] [<mesh>.(obj/.ply)] [<texture>.(png/jpg)] [-<uniformName> <texture>.(png/jpg)] [-vFlip] [-x <x>] [-y <y>] [-w <width>] [-h <height>] [-l] [--square] [-s/--sec <seconds>] [-o <screenshot_file>.png] [--headless] [-c/--cursor] [--no-mesh-cache] [--optimize-mesh] [--optimize-overdraw] [--lod] [--scale <scale>] [--buffer-scale <scale>] [--buffer-format <format>] [--target-fps <fps>] [--accumulate <samples>] [--on-demand] [--no-vsync] [--max-fps <fps>] [--frames-in-flight <frames>] [--check-allocations] [--overlay] [--gl-calls] [--shader-stats] [--heatmap <max>] [--tile-render <width>x<height>] [--trace <trace_file>.json] [--bench <frames>] [--bench-variant \"<define> ...\"] [--compare <golden>.png] [--compare-tolerance <percent>] [--max-slowdown <percent>] [--compare-baseline <file>.ms] [--update-golden] [--fixed-time <seconds>] [--scene <shader>.frag ...] [-I<include_folder>] [-D<define>] [-v/--verbose] [--help]\n";
 }
@@ -0,0 +1,53 @@
+#include "allocations.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Trivially initialized, so it can be used before (and after) static constructors run
+thread_local unsigned long allocations = 0;
+
+}
+
+unsigned long getThreadAllocations() {
+    return allocations;
+}
+
+void* operator new(std::size_t _size) {
+    allocations++;
+    void* ptr = malloc(_size > 0? _size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t _size) {
+    return operator new(_size);
+}
+
+void* operator new(std::size_t _size, const std::nothrow_t&) noexcept {
+    allocations++;
+    return malloc(_size > 0? _size : 1);
+}
+
+void* operator new[](std::size_t _size, const std::nothrow_t& _nothrow) noexcept {
+    return operator new(_size, _nothrow);
+}
+
+void operator delete(void* _ptr) noexcept {
+    free(_ptr);
+}
+
+void operator delete[](void* _ptr) noexcept {
+    free(_ptr);
+}
+
+void operator delete(void* _ptr, std::size_t) noexcept {
+    free(_ptr);
+}
+
+void operator delete[](void* _ptr, std::size_t) noexcept {
+    free(_ptr);
+}
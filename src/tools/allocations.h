@@ -0,0 +1,6 @@
+#pragma once
+
+//  Heap allocations made through operator new by the calling thread since it started.
+//  Linking this file replaces the global operator new/delete with ones that count them
+//  (and otherwise forward to malloc/free).
+unsigned long getThreadAllocations();
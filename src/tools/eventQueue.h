@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+//---------------------------------------- EventQueue
+//  Queue that any number of threads push to and a single one takes from. Producers only hold
+//  the lock for the push; the consumer takes everything queued at a point of its choosing, or
+//  waits for the next one.
+template <typename T>
+class EventQueue {
+public:
+    void    push(const T& _event) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_events.push_back(_event);
+        }
+        m_pushed.notify_one();
+    }
+
+    //  Take the oldest event, false if there is none
+    bool    pop(T& _event) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_events.empty()) {
+            return false;
+        }
+        _event = m_events.front();
+        m_events.erase(m_events.begin());
+        return true;
+    }
+
+    //  Same, waiting up to _timeout for one to be pushed
+    template <class Rep, class Period>
+    bool    pop(T& _event, const std::chrono::duration<Rep, Period>& _timeout) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_pushed.wait_for(lock, _timeout, [this]() { return !m_events.empty(); })) {
+            return false;
+        }
+        _event = m_events.front();
+        m_events.erase(m_events.begin());
+        return true;
+    }
+
+    //  Take all the events, in the order they were pushed. They are swapped into _events (which
+    //  should be empty) so the memory of both vectors is reused from one call to the next
+    bool    popAll(std::vector<T>& _events) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        _events.swap(m_events);
+        return !_events.empty();
+    }
+
+    bool    empty() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_events.empty();
+    }
+
+private:
+    std::vector<T>  m_events;
+    std::mutex      m_mutex;
+    std::condition_variable m_pushed;
+};
@@ -0,0 +1,96 @@
+#include "frameStats.h"
+
+#include <algorithm>
+#include <sstream>
+
+FrameStats::FrameStats(): m_frames(0) {
+}
+
+FrameStats::~FrameStats() {
+}
+
+int FrameStats::addSection(const std::string& _group, const std::string& _name, bool _count) {
+    // Reserved where it stays, a copy of the vector wouldn't keep the capacity
+    m_sections.push_back(Section());
+    Section& section = m_sections.back();
+    section.group = _group;
+    section.name = _name;
+    section.samples.reserve(FRAME_STATS_WINDOW);
+    section.next = 0;
+    section.last = 0.0;
+    section.count = _count;
+    return m_sections.size() - 1;
+}
+
+void FrameStats::add(int _section, double _milliseconds) {
+    Section& section = m_sections[_section];
+    if (section.samples.size() < FRAME_STATS_WINDOW) {
+        section.samples.push_back(_milliseconds);
+    }
+    else {
+        section.samples[section.next] = _milliseconds;
+    }
+    section.next = (section.next + 1) % FRAME_STATS_WINDOW;
+    section.last = _milliseconds;
+}
+
+double FrameStats::getSample(int _section, int _index) const {
+    const Section& section = m_sections[_section];
+    // Until the ring is full the oldest one is the first
+    size_t start = (section.samples.size() < FRAME_STATS_WINDOW)? 0 : section.next;
+    return section.samples[(start + _index) % section.samples.size()];
+}
+
+double FrameStats::percentile(const std::vector<double>& _sorted, double _percent) {
+    size_t rank = (size_t)(_percent / 100.0 * (_sorted.size() - 1) + 0.5);
+    return _sorted[rank];
+}
+
+double FrameStats::since(const std::chrono::steady_clock::time_point& _start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+}
+
+std::string FrameStats::toJson() const {
+    std::stringstream json;
+    json << "{\"frames\":" << m_frames;
+
+    // Sections of a group are written together, in the order the groups were first seen
+    std::vector<std::string> groups;
+    for (size_t i = 0; i < m_sections.size(); i++) {
+        if (std::find(groups.begin(), groups.end(), m_sections[i].group) == groups.end()) {
+            groups.push_back(m_sections[i].group);
+        }
+    }
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        json << ",\"" << groups[g] << "\":{";
+        bool first = true;
+        for (size_t i = 0; i < m_sections.size(); i++) {
+            const Section& section = m_sections[i];
+            if (section.group != groups[g] || section.samples.empty()) {
+                continue;
+            }
+
+            std::vector<double> sorted = section.samples;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for (size_t s = 0; s < sorted.size(); s++) {
+                sum += sorted[s];
+            }
+
+            json << (first? "" : ",") << "\"" << section.name << "\":{";
+            json << "\"last\":" << section.last;
+            json << ",\"avg\":" << sum / sorted.size();
+            json << ",\"p50\":" << percentile(sorted, 50.0);
+            json << ",\"p90\":" << percentile(sorted, 90.0);
+            json << ",\"p99\":" << percentile(sorted, 99.0);
+            json << ",\"max\":" << sorted.back();
+            json << "}";
+            first = false;
+        }
+        json << "}";
+    }
+
+    json << "}";
+    return json.str();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+//  Samples kept per section for the rolling percentiles
+#define FRAME_STATS_WINDOW 256
+
+//  Rolling statistics of how many milliseconds the parts of a frame take (or of anything else
+//  counted per frame). Sections are registered once and then fed a measure each frame (or
+//  whenever one arrives, for the GPU)
+class FrameStats {
+public:
+    FrameStats();
+    virtual ~FrameStats();
+
+    //  Register a section of _group ("cpu", "gpu"...), returns the id to add measures to it.
+    //  _count sections measure how many of something there were instead of milliseconds
+    int     addSection(const std::string& _group, const std::string& _name, bool _count = false);
+
+    void    add(int _section, double _milliseconds);
+    void    nextFrame() { m_frames++; }
+
+    int     size() const { return m_sections.size(); }
+    const std::string& getGroup(int _section) const { return m_sections[_section].group; }
+    const std::string& getName(int _section) const { return m_sections[_section].name; }
+    double  getLast(int _section) const { return m_sections[_section].last; }
+    bool    isCount(int _section) const { return m_sections[_section].count; }
+
+    //  Measures kept of _section, and the _index one of them, oldest first
+    int     getSamples(int _section) const { return m_sections[_section].samples.size(); }
+    double  getSample(int _section, int _index) const;
+
+    //  Nearest rank _percent percentile of _sorted (ascending, not empty) measures
+    static double percentile(const std::vector<double>& _sorted, double _percent);
+
+    //  Milliseconds since _start, for CPU sections
+    static double since(const std::chrono::steady_clock::time_point& _start);
+
+    //  {"frames":N,"<group>":{"<name>":{"last":..,"avg":..,"p50":..,"p90":..,"p99":..,"max":..}}}
+    //  Sections without measures yet are left out
+    std::string toJson() const;
+
+private:
+    struct Section {
+        std::string         group;
+        std::string         name;
+        std::vector<double> samples;    // ring of the last FRAME_STATS_WINDOW measures
+        size_t              next;
+        double              last;
+        bool                count;
+    };
+
+    std::vector<Section>    m_sections;
+    unsigned long           m_frames;
+};
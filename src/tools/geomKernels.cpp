@@ -0,0 +1,293 @@
+#include "tools/geomKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+#include "tools/parallel.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GEOM_SIMD_WIDTH 8
+typedef __m256 simd_float;
+#define simd_load(p)    _mm256_loadu_ps(p)
+#define simd_store(p,a) _mm256_storeu_ps(p,a)
+#define simd_zero()     _mm256_setzero_ps()
+#define simd_add(a,b)   _mm256_add_ps(a,b)
+#define simd_min(a,b)   _mm256_min_ps(a,b)
+#define simd_max(a,b)   _mm256_max_ps(a,b)
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define GEOM_SIMD_WIDTH 4
+typedef __m128 simd_float;
+#define simd_load(p)    _mm_loadu_ps(p)
+#define simd_store(p,a) _mm_storeu_ps(p,a)
+#define simd_zero()     _mm_setzero_ps()
+#define simd_add(a,b)   _mm_add_ps(a,b)
+#define simd_min(a,b)   _mm_min_ps(a,b)
+#define simd_max(a,b)   _mm_max_ps(a,b)
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GEOM_SIMD_WIDTH 4
+typedef float32x4_t simd_float;
+#define simd_load(p)    vld1q_f32(p)
+#define simd_store(p,a) vst1q_f32(p,a)
+#define simd_zero()     vdupq_n_f32(0.0f)
+#define simd_add(a,b)   vaddq_f32(a,b)
+#define simd_min(a,b)   vminq_f32(a,b)
+#define simd_max(a,b)   vmaxq_f32(a,b)
+#endif
+
+// Points per parallelFor block, below that threads cost more than they save
+#define GEOM_MIN_BLOCK 65536
+
+// SIMD iterations summed in single precision before flushing to the double accumulator
+#define GEOM_SUM_FLUSH 1024
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 is expected to be three packed floats");
+
+namespace {
+
+struct BoundsBlock {
+    size_t      begin;
+    glm::dvec3  sum;
+    glm::vec3   min;
+    glm::vec3   max;
+};
+
+// Sum, min and max of _n points starting at _pts
+void boundsKernel(const glm::vec3* _pts, size_t _n, BoundsBlock &_out) {
+    _out.sum = glm::dvec3(0.0);
+    _out.min = _pts[0];
+    _out.max = _pts[0];
+
+    size_t i = 0;
+
+#ifdef GEOM_SIMD_WIDTH
+    //  GEOM_SIMD_WIDTH points are 3 registers of interleaved xyz. As 3 * GEOM_SIMD_WIDTH is a
+    //  multiple of 3, lane k of register r always holds the component (r * GEOM_SIMD_WIDTH + k) % 3,
+    //  so the three registers can be accumulated independently and folded per component at the end.
+    if (_n >= GEOM_SIMD_WIDTH) {
+        const float* f = (const float*)_pts;
+        simd_float mn[3], mx[3], partial[3];
+        for (int r = 0; r < 3; r++) {
+            mn[r] = mx[r] = simd_load(f + r * GEOM_SIMD_WIDTH);
+            partial[r] = simd_zero();
+        }
+
+        float lanes[3 * GEOM_SIMD_WIDTH];
+        size_t steps = 0;
+        for (; i + GEOM_SIMD_WIDTH <= _n; i += GEOM_SIMD_WIDTH) {
+            const float* p = f + i * 3;
+            for (int r = 0; r < 3; r++) {
+                simd_float v = simd_load(p + r * GEOM_SIMD_WIDTH);
+                mn[r] = simd_min(mn[r], v);
+                mx[r] = simd_max(mx[r], v);
+                partial[r] = simd_add(partial[r], v);
+            }
+
+            if (++steps == GEOM_SUM_FLUSH) {
+                for (int r = 0; r < 3; r++) {
+                    simd_store(lanes + r * GEOM_SIMD_WIDTH, partial[r]);
+                    partial[r] = simd_zero();
+                }
+                for (int l = 0; l < 3 * GEOM_SIMD_WIDTH; l++) {
+                    _out.sum[l % 3] += lanes[l];
+                }
+                steps = 0;
+            }
+        }
+
+        for (int r = 0; r < 3; r++) {
+            simd_store(lanes + r * GEOM_SIMD_WIDTH, partial[r]);
+        }
+        for (int l = 0; l < 3 * GEOM_SIMD_WIDTH; l++) {
+            _out.sum[l % 3] += lanes[l];
+        }
+
+        for (int r = 0; r < 3; r++) {
+            simd_store(lanes + r * GEOM_SIMD_WIDTH, mn[r]);
+        }
+        for (int l = 0; l < 3 * GEOM_SIMD_WIDTH; l++) {
+            _out.min[l % 3] = std::min(_out.min[l % 3], lanes[l]);
+        }
+
+        for (int r = 0; r < 3; r++) {
+            simd_store(lanes + r * GEOM_SIMD_WIDTH, mx[r]);
+        }
+        for (int l = 0; l < 3 * GEOM_SIMD_WIDTH; l++) {
+            _out.max[l % 3] = std::max(_out.max[l % 3], lanes[l]);
+        }
+    }
+#endif
+
+    for (; i < _n; i++) {
+        _out.sum += glm::dvec3(_pts[i]);
+        _out.min = glm::min(_out.min, _pts[i]);
+        _out.max = glm::max(_out.max, _pts[i]);
+    }
+}
+
+// Blocks are merged in order so the result does not depend on thread scheduling
+BoundsBlock computeBoundsBlocks(const std::vector<glm::vec3> &_pts) {
+    std::vector<BoundsBlock> blocks;
+    std::mutex mutex;
+
+    parallelFor(_pts.size(), [&](size_t _begin, size_t _end) {
+        BoundsBlock block;
+        block.begin = _begin;
+        boundsKernel(&_pts[_begin], _end - _begin, block);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks.push_back(block);
+    }, GEOM_MIN_BLOCK);
+
+    std::sort(blocks.begin(), blocks.end(), [](const BoundsBlock &_a, const BoundsBlock &_b) {
+        return _a.begin < _b.begin;
+    });
+
+    BoundsBlock total = blocks[0];
+    for (size_t i = 1; i < blocks.size(); i++) {
+        total.sum += blocks[i].sum;
+        total.min = glm::min(total.min, blocks[i].min);
+        total.max = glm::max(total.max, blocks[i].max);
+    }
+    return total;
+}
+
+}
+
+GeomBounds computeBounds(const std::vector<glm::vec3> &_pts) {
+    GeomBounds bounds;
+    if (_pts.empty()) {
+        bounds.min = bounds.max = bounds.centroid = glm::vec3(0.0);
+        bounds.radius = 0.0;
+        return bounds;
+    }
+
+    BoundsBlock total = computeBoundsBlocks(_pts);
+    bounds.min = total.min;
+    bounds.max = total.max;
+    bounds.centroid = glm::vec3(total.sum / (double)_pts.size());
+    bounds.radius = computeBoundingRadius(_pts, bounds.centroid);
+    return bounds;
+}
+
+glm::vec3 computeCentroid(const std::vector<glm::vec3> &_pts) {
+    if (_pts.empty()) {
+        return glm::vec3(0.0);
+    }
+    return glm::vec3(computeBoundsBlocks(_pts).sum / (double)_pts.size());
+}
+
+void computeBoundingBox(const std::vector<glm::vec3> &_pts, glm::vec3 &_min, glm::vec3 &_max) {
+    if (_pts.empty()) {
+        _min = _max = glm::vec3(0.0);
+        return;
+    }
+
+    BoundsBlock total = computeBoundsBlocks(_pts);
+    _min = total.min;
+    _max = total.max;
+}
+
+float computeBoundingRadius(const std::vector<glm::vec3> &_pts, const glm::vec3 &_center) {
+    std::atomic<float> radius2(0.0f);
+
+    parallelFor(_pts.size(), [&](size_t _begin, size_t _end) {
+        float max2 = 0.0;
+        for (size_t i = _begin; i < _end; i++) {
+            glm::vec3 d = _pts[i] - _center;
+            max2 = std::max(max2, glm::dot(d, d));
+        }
+
+        float current = radius2.load();
+        while (max2 > current && !radius2.compare_exchange_weak(current, max2)) {
+        }
+    }, GEOM_MIN_BLOCK);
+
+    return sqrt(radius2.load());
+}
+
+void computeFaceNormals(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, std::vector<glm::vec3> &_normals) {
+    size_t nTriangles = _indices.size() / 3;
+    _normals.resize(nTriangles);
+
+    parallelFor(nTriangles, [&](size_t _begin, size_t _end) {
+        for (size_t t = _begin; t < _end; t++) {
+            const glm::vec3 &v1 = _vertices[ _indices[t * 3] ];
+            const glm::vec3 &v2 = _vertices[ _indices[t * 3 + 1] ];
+            const glm::vec3 &v3 = _vertices[ _indices[t * 3 + 2] ];
+            _normals[t] = glm::cross(v2 - v1, v3 - v1);
+        }
+    }, GEOM_MIN_BLOCK);
+}
+
+void computeVertexNormals(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, std::vector<glm::vec3> &_normals) {
+    size_t nVertices = _vertices.size();
+    size_t nTriangles = _indices.size() / 3;
+
+    _normals.assign(nVertices, glm::vec3(0.0));
+    if (nVertices == 0) {
+        return;
+    }
+
+    //  Triangles and vertices are split in the same number of parts and each thread
+    //  only writes the normals of its own vertex range. Contributions to vertices owned
+    //  by another part are queued for it, which on meshes where the triangles follow the
+    //  vertex order (as produced by the loaders) is only a thin border between parts.
+    size_t nParts = std::min(getNumThreads(), std::max((unsigned int)(nTriangles / GEOM_MIN_BLOCK), 1u));
+    size_t partVertices = (nVertices + nParts - 1) / nParts;
+    size_t partTriangles = (nTriangles + nParts - 1) / nParts;
+
+    struct Contribution {
+        INDEX_TYPE  vertex;
+        glm::vec3   normal;
+    };
+    // queues[from * nParts + to]
+    std::vector< std::vector<Contribution> > queues(nParts * nParts);
+
+    parallelFor(nParts, [&](size_t _begin, size_t _end) {
+        for (size_t part = _begin; part < _end; part++) {
+            size_t first = part * partVertices;
+            size_t last = first + partVertices;
+            size_t end = std::min((part + 1) * partTriangles, nTriangles);
+
+            for (size_t t = part * partTriangles; t < end; t++) {
+                const INDEX_TYPE* tri = &_indices[t * 3];
+                const glm::vec3 &v1 = _vertices[ tri[0] ];
+                glm::vec3 normal = glm::cross(_vertices[ tri[1] ] - v1, _vertices[ tri[2] ] - v1);
+
+                for (int k = 0; k < 3; k++) {
+                    if (tri[k] >= first && tri[k] < last) {
+                        _normals[ tri[k] ] += normal;
+                    }
+                    else {
+                        queues[part * nParts + tri[k] / partVertices].push_back( { tri[k], normal } );
+                    }
+                }
+            }
+        }
+    }, 1);
+
+    parallelFor(nParts, [&](size_t _begin, size_t _end) {
+        for (size_t part = _begin; part < _end; part++) {
+            // Queues are drained in part order so the sums don't depend on thread scheduling
+            for (size_t from = 0; from < nParts; from++) {
+                const std::vector<Contribution> &queue = queues[from * nParts + part];
+                for (size_t i = 0; i < queue.size(); i++) {
+                    _normals[ queue[i].vertex ] += queue[i].normal;
+                }
+            }
+
+            size_t end = std::min((part + 1) * partVertices, nVertices);
+            for (size_t v = part * partVertices; v < end; v++) {
+                float length = glm::length(_normals[v]);
+                _normals[v] = (length > 0.0)? _normals[v] / length : glm::vec3(0.0, 0.0, 1.0);
+            }
+        }
+    }, 1);
+}
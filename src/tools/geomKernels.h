@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "gl/vbo.h"
+
+//---------------------------------------- Geometry kernels
+//  Data parallel versions of the per vertex / per triangle loops used when loading
+//  large meshes. They split the work with parallelFor and use SSE, AVX or NEON for
+//  the streaming passes when the compiler targets them.
+
+//  Bounds of a set of points
+struct GeomBounds {
+    glm::vec3   min;
+    glm::vec3   max;
+    glm::vec3   centroid;
+    float       radius;     // of the sphere centered on the centroid enclosing all the points
+};
+
+GeomBounds  computeBounds(const std::vector<glm::vec3> &_pts);
+
+glm::vec3   computeCentroid(const std::vector<glm::vec3> &_pts);
+void        computeBoundingBox(const std::vector<glm::vec3> &_pts, glm::vec3 &_min, glm::vec3 &_max);
+float       computeBoundingRadius(const std::vector<glm::vec3> &_pts, const glm::vec3 &_center);
+
+//  Cross product of the edges of each triangle. Their length is twice the area of the triangle.
+void        computeFaceNormals(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, std::vector<glm::vec3> &_normals);
+
+//  Normalized sum of the face normals around each vertex, weighted by the area of the faces
+void        computeVertexNormals(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, std::vector<glm::vec3> &_normals);
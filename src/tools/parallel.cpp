@@ -0,0 +1,139 @@
+#include "tools/parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+unsigned int getNumThreads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return (n > 0)? n : 1;
+}
+
+namespace {
+
+// Set while a thread runs blocks of a parallelFor, nested calls then run in place
+thread_local bool inParallelFor = false;
+
+//  Workers are started once and sleep between jobs, so parallelFor can be used
+//  on small ranges (every frame, every reload) without paying for thread creation.
+class ThreadPool {
+public:
+    ThreadPool(): m_func(nullptr), m_count(0), m_blockSize(0), m_nBlocks(0), m_nextBlock(0), m_busy(0), m_generation(0), m_stop(false) {
+        for (unsigned int i = 1; i < getNumThreads(); i++) {
+            m_workers.push_back( std::thread(&ThreadPool::work, this) );
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            m_workers[i].join();
+        }
+    }
+
+    void run(size_t _count, size_t _nBlocks, const std::function<void(size_t, size_t)> &_func) {
+        // One job at a time, the calling thread works on it too
+        std::lock_guard<std::mutex> job(m_jobMutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_func = &_func;
+            m_count = _count;
+            m_nBlocks = _nBlocks;
+            m_blockSize = (_count + _nBlocks - 1) / _nBlocks;
+            m_nextBlock = 0;
+            m_busy = m_workers.size();
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        runBlocks();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]{ return m_busy == 0; });
+        m_func = nullptr;
+    }
+
+private:
+    void runBlocks() {
+        inParallelFor = true;
+        for (size_t block = m_nextBlock++; block < m_nBlocks; block = m_nextBlock++) {
+            size_t begin = block * m_blockSize;
+            size_t end = (begin + m_blockSize < m_count)? begin + m_blockSize : m_count;
+            if (begin < end) {
+                (*m_func)(begin, end);
+            }
+        }
+        inParallelFor = false;
+    }
+
+    void work() {
+        unsigned int generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]{ return m_stop || m_generation != generation; });
+                if (m_stop) {
+                    return;
+                }
+                generation = m_generation;
+            }
+
+            runBlocks();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread>    m_workers;
+    std::mutex                  m_jobMutex;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;
+    std::condition_variable     m_done;
+
+    const std::function<void(size_t, size_t)>* m_func;
+    size_t                      m_count;
+    size_t                      m_blockSize;
+    size_t                      m_nBlocks;
+    std::atomic<size_t>         m_nextBlock;
+    size_t                      m_busy;
+    unsigned int                m_generation;
+    bool                        m_stop;
+};
+
+ThreadPool& getThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+}
+
+void parallelFor(size_t _count, const std::function<void(size_t, size_t)> &_func, size_t _minBlock) {
+    if (_count == 0) {
+        return;
+    }
+
+    if (_minBlock == 0) {
+        _minBlock = 1;
+    }
+
+    size_t nBlocks = (_count + _minBlock - 1) / _minBlock;
+    if (nBlocks > getNumThreads()) {
+        nBlocks = getNumThreads();
+    }
+
+    if (nBlocks <= 1 || inParallelFor) {
+        _func(0, _count);
+        return;
+    }
+
+    getThreadPool().run(_count, nBlocks, _func);
+}
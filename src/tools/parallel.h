@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+//---------------------------------------- Parallel
+//  Number of threads used for data-parallel work (at least 1)
+unsigned int getNumThreads();
+
+//  Split the range [0, _count) into contiguous blocks of at least _minBlock elements
+//  and call _func(begin, end) for each of them concurrently. Returns when all blocks are done.
+//  Blocks run on a pool of persistent worker threads plus the calling thread; a parallelFor
+//  issued from inside another one runs serially on the thread that issued it.
+void parallelFor(size_t _count, const std::function<void(size_t, size_t)> &_func, size_t _minBlock = 1);
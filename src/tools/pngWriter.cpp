@@ -0,0 +1,154 @@
+#include "pngWriter.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#define PNG_IDAT_SIZE 65536
+
+namespace {
+
+void putUint32(unsigned char* _dst, uint32_t _value) {
+    _dst[0] = (_value >> 24) & 0xFF;
+    _dst[1] = (_value >> 16) & 0xFF;
+    _dst[2] = (_value >> 8) & 0xFF;
+    _dst[3] = _value & 0xFF;
+}
+
+}
+
+PngWriter::PngWriter(): m_outSize(0), m_file(nullptr), m_width(0), m_height(0), m_rows(0) {
+    memset(&m_zstream, 0, sizeof(m_zstream));
+}
+
+PngWriter::~PngWriter() {
+    if (m_file != nullptr) {
+        deflateEnd(&m_zstream);
+        fclose(m_file);
+    }
+}
+
+bool PngWriter::open(const std::string& _path, int _width, int _height) {
+    m_file = fopen(_path.c_str(), "wb");
+    if (m_file == nullptr) {
+        std::cerr << "can't create file " << _path << std::endl;
+        return false;
+    }
+
+    m_width = _width;
+    m_height = _height;
+    m_rows = 0;
+    m_row.resize(1 + m_width * 4);
+    m_previous.assign(m_width * 4, 0);
+    m_out.resize(PNG_IDAT_SIZE);
+    m_outSize = 0;
+
+    memset(&m_zstream, 0, sizeof(m_zstream));
+    if (deflateInit(&m_zstream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        std::cerr << "can't start compressing " << _path << std::endl;
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char header[13];
+    putUint32(header, m_width);
+    putUint32(header + 4, m_height);
+    header[8] = 8;      // bits per channel
+    header[9] = 6;      // RGBA
+    header[10] = 0;     // deflate
+    header[11] = 0;     // adaptive filtering
+    header[12] = 0;     // not interlaced
+
+    return fwrite(signature, 1, 8, m_file) == 8 && writeChunk("IHDR", header, 13);
+}
+
+bool PngWriter::writeRows(const unsigned char* _pixels, int _count) {
+    if (m_file == nullptr || m_rows + _count > m_height) {
+        return false;
+    }
+
+    size_t stride = m_width * 4;
+    for (int r = 0; r < _count; r++) {
+        // Up filter: the difference with the pixel above compresses better than the pixel
+        const unsigned char* row = _pixels + r * stride;
+        m_row[0] = 2;
+        for (size_t i = 0; i < stride; i++) {
+            m_row[1 + i] = row[i] - m_previous[i];
+        }
+        memcpy(m_previous.data(), row, stride);
+
+        m_zstream.next_in = m_row.data();
+        m_zstream.avail_in = m_row.size();
+        if (!deflateRows(Z_NO_FLUSH)) {
+            return false;
+        }
+        m_rows++;
+    }
+    return true;
+}
+
+bool PngWriter::close() {
+    if (m_file == nullptr) {
+        return false;
+    }
+
+    bool success = m_rows == m_height;
+    if (!success) {
+        std::cerr << "PNG closed with " << m_rows << " of its " << m_height << " rows" << std::endl;
+    }
+
+    success = deflateRows(Z_FINISH) && success;
+    success = writeChunk("IEND", nullptr, 0) && success;
+
+    deflateEnd(&m_zstream);
+    success = (fclose(m_file) == 0) && success;
+    m_file = nullptr;
+    return success;
+}
+
+bool PngWriter::deflateRows(int _flush) {
+    while (true) {
+        m_zstream.next_out = m_out.data() + m_outSize;
+        m_zstream.avail_out = m_out.size() - m_outSize;
+        int result = deflate(&m_zstream, _flush);
+        if (result == Z_STREAM_ERROR) {
+            return false;
+        }
+        m_outSize = m_out.size() - m_zstream.avail_out;
+
+        // Full IDAT chunks, and the last one with what is left
+        if (m_outSize == m_out.size() || (result == Z_STREAM_END && m_outSize > 0)) {
+            if (!writeChunk("IDAT", m_out.data(), m_outSize)) {
+                return false;
+            }
+            m_outSize = 0;
+        }
+
+        if (_flush == Z_FINISH) {
+            if (result == Z_STREAM_END) {
+                return true;
+            }
+        }
+        else if (m_zstream.avail_in == 0 && m_zstream.avail_out != 0) {
+            return true;
+        }
+    }
+}
+
+bool PngWriter::writeChunk(const char* _type, const unsigned char* _data, size_t _size) {
+    unsigned char length[4], crc[4];
+    putUint32(length, _size);
+
+    uLong sum = crc32(0, (const Bytef*)_type, 4);
+    if (_size > 0) {
+        sum = crc32(sum, _data, _size);
+    }
+    putUint32(crc, sum);
+
+    return  fwrite(length, 1, 4, m_file) == 4 &&
+            fwrite(_type, 1, 4, m_file) == 4 &&
+            (_size == 0 || fwrite(_data, 1, _size, m_file) == _size) &&
+            fwrite(crc, 1, 4, m_file) == 4;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+//  Writes an RGBA8 PNG a few rows at a time, compressing them as they come, so images
+//  bigger than what fits in memory can be saved
+class PngWriter {
+public:
+    PngWriter();
+    virtual ~PngWriter();
+
+    bool    open(const std::string& _path, int _width, int _height);
+
+    //  Append _count rows (top to bottom) of _width RGBA pixels each
+    bool    writeRows(const unsigned char* _pixels, int _count);
+
+    //  Finish the file, false if it is missing rows or couldn't be written
+    bool    close();
+
+private:
+    bool    writeChunk(const char* _type, const unsigned char* _data, size_t _size);
+    bool    deflateRows(int _flush);
+
+    std::vector<unsigned char>  m_row;      // filter byte + filtered row
+    std::vector<unsigned char>  m_previous; // last row, for the Up filter
+    std::vector<unsigned char>  m_out;      // compressed data waiting for its IDAT chunk
+    size_t                      m_outSize;
+
+    z_stream    m_zstream;
+    FILE*       m_file;
+    int         m_width;
+    int         m_height;
+    int         m_rows;
+};
@@ -145,3 +145,14 @@ bool beginsWith(const std::string &_stringA, const std::string &_stringB) {
     }
     return true;
 }
+
+std::string getHash(const std::string &_string) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < _string.size(); i++) {
+        hash ^= (unsigned char)_string[i];
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream out;
+    out << std::hex << std::setfill('0') << std::setw(16) << hash;
+    return out.str();
+}
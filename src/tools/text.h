@@ -30,6 +30,9 @@ std::vector<std::string> split(const std::string &_string, char _sep);
 
 bool isFloat(const std::string &_string);
 
+// 64 bit FNV-1a hash of a string, as 16 hex digits, to tell versions of a source apart
+std::string getHash(const std::string &_string);
+
 //---------------------------------------- Conversions
 bool toBool(const std::string &_string);
 char toChar(const std::string &_string);
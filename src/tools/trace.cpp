@@ -0,0 +1,161 @@
+#include "trace.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> tracing(false);
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int64_t     start;      // nanoseconds since the trace started
+    int64_t     duration;
+};
+
+//  Only its thread writes to it, the lock is there for traceStop() to read it
+struct TraceBuffer {
+    std::mutex              mutex;
+    std::vector<TraceEvent> events;
+    size_t                  next = 0;
+    size_t                  count = 0;
+    const char*             name = nullptr;
+    int                     id = 0;
+};
+
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<TraceBuffer> > buffers;   // outlive their threads, to be saved
+thread_local TraceBuffer* threadBuffer = nullptr;
+
+std::chrono::steady_clock::time_point origin;
+std::string path;
+
+TraceBuffer* addBuffer(const char* _name) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+    TraceBuffer* buffer = buffers.back().get();
+    buffer->name = _name;
+    buffer->id = buffers.size();
+    return buffer;
+}
+
+void record(TraceBuffer* _buffer, const char* _name, const std::chrono::steady_clock::time_point& _start, int64_t _duration) {
+    std::lock_guard<std::mutex> lock(_buffer->mutex);
+    if (_buffer->events.empty()) {
+        _buffer->events.resize(TRACE_RING_SIZE);
+    }
+
+    TraceEvent& event = _buffer->events[_buffer->next];
+    event.name = _name;
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(_start - origin).count();
+    event.duration = _duration;
+
+    _buffer->next = (_buffer->next + 1) % TRACE_RING_SIZE;
+    if (_buffer->count < TRACE_RING_SIZE) {
+        _buffer->count++;
+    }
+}
+
+//  Names are written as they are, they are expected to be plain identifiers
+void writeEvent(FILE* _file, bool& _first, const TraceEvent& _event, int _id) {
+    fprintf(_file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            _first? "" : ",", _event.name, _id, _event.start * 1e-3, _event.duration * 1e-3);
+    _first = false;
+}
+
+}
+
+void traceStart(const std::string& _path) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        std::lock_guard<std::mutex> bufferLock(buffers[i]->mutex);
+        buffers[i]->next = 0;
+        buffers[i]->count = 0;
+    }
+    origin = std::chrono::steady_clock::now();
+    path = _path;
+    tracing.store(true);
+}
+
+bool traceStop() {
+    if (!tracing.load()) {
+        return false;
+    }
+    tracing.store(false);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        std::cerr << "can't create file " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    bool first = true;
+    fprintf(file, "{\"traceEvents\":[");
+    for (size_t i = 0; i < buffers.size(); i++) {
+        TraceBuffer& buffer = *buffers[i];
+        std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+
+        if (buffer.name != nullptr) {
+            fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first? "" : ",", buffer.id, buffer.name);
+            first = false;
+        }
+
+        // Oldest first
+        size_t oldest = (buffer.next + TRACE_RING_SIZE - buffer.count) % TRACE_RING_SIZE;
+        for (size_t e = 0; e < buffer.count; e++) {
+            writeEvent(file, first, buffer.events[(oldest + e) % TRACE_RING_SIZE], buffer.id);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool success = !ferror(file);
+    success = (fclose(file) == 0) && success;
+    if (success) {
+        std::cout << "// Trace saved to " << path << std::endl;
+    }
+    return success;
+}
+
+void traceThreadName(const char* _name) {
+    if (threadBuffer == nullptr) {
+        threadBuffer = addBuffer(_name);
+    }
+    else {
+        threadBuffer->name = _name;
+    }
+}
+
+void traceZone(const char* _name, const std::chrono::steady_clock::time_point& _start) {
+    if (threadBuffer == nullptr) {
+        threadBuffer = addBuffer(nullptr);
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    record(threadBuffer, _name, _start, std::chrono::duration_cast<std::chrono::nanoseconds>(now - _start).count());
+}
+
+void traceTrackZone(const char* _track, const char* _name, const std::chrono::steady_clock::time_point& _start, double _milliseconds) {
+    if (!tracing.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    TraceBuffer* track = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (size_t i = 0; i < buffers.size() && track == nullptr; i++) {
+            if (buffers[i]->name != nullptr && strcmp(buffers[i]->name, _track) == 0) {
+                track = buffers[i].get();
+            }
+        }
+    }
+    if (track == nullptr) {
+        track = addBuffer(_track);
+    }
+    record(track, _name, _start, (int64_t)(_milliseconds * 1e6));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+//  Events each thread keeps, the oldest are overwritten
+#define TRACE_RING_SIZE 65536
+
+//  Scoped zones recorded to a ring buffer per thread and saved as Chrome trace events
+//  (chrome://tracing, ui.perfetto.dev). When tracing is off a zone only reads a flag.
+//  Zone names have to outlive the trace (string literals).
+
+extern std::atomic<bool> tracing;
+
+//  Start recording, to be saved to _path by traceStop()
+void traceStart(const std::string& _path);
+
+//  Save what was recorded and stop, false if the file couldn't be written
+bool traceStop();
+
+//  Name the track of the calling thread
+void traceThreadName(const char* _name);
+
+//  Record a zone of the calling thread that started at _start and ends now
+void traceZone(const char* _name, const std::chrono::steady_clock::time_point& _start);
+
+//  Record a zone on a track of its own (like the GPU one), that lasted _milliseconds from _start
+void traceTrackZone(const char* _track, const char* _name, const std::chrono::steady_clock::time_point& _start, double _milliseconds);
+
+class TraceZone {
+public:
+    TraceZone(const char* _name): m_name(_name), m_on(tracing.load(std::memory_order_relaxed)) {
+        if (m_on) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+    ~TraceZone() {
+        if (m_on) {
+            traceZone(m_name, m_start);
+        }
+    }
+
+private:
+    std::chrono::steady_clock::time_point   m_start;
+    const char*                             m_name;
+    bool                                    m_on;
+};
+
+#define TRACE_CONCAT_(_a, _b) _a##_b
+#define TRACE_CONCAT(_a, _b) TRACE_CONCAT_(_a, _b)
+#define TRACE_ZONE(_name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(_name)
@@ -5,10 +5,15 @@
 
 #include "tools/fs.h"
 #include "tools/geom.h"
+#include "tools/geomKernels.h"
+#include "tools/parallel.h"
 #include "tools/text.h"
+#include "tools/trace.h"
 #include "gl/vertexLayout.h"
 
-#include "tinyobjloader/tiny_obj_loader.h"
+#include "types/obj.h"
+#include "types/meshCache.h"
+#include "types/meshOptimizer.h"
 
 Mesh::Mesh():m_drawMode(GL_TRIANGLES) {
 
@@ -23,6 +28,7 @@ Mesh::~Mesh(){
 }
 
 bool Mesh::load(const std::string& _file) {
+    TRACE_ZONE("Mesh::load");
     if ( haveExt(_file,"ply") || haveExt(_file,"PLY") ){
         std::fstream is(_file.c_str(), std::ios::in);
         if(is.is_open()){
@@ -60,7 +66,7 @@ bool Mesh::load(const std::string& _file) {
             std::vector<glm::vec3> vertices;
             std::vector<glm::vec3> normals;
             std::vector<glm::vec2> texcoord;
-            std::vector<uint16_t> indices;
+            std::vector<INDEX_TYPE> indices;
 
             std::getline(is,line);
             lineNum++;
@@ -242,13 +248,13 @@ bool Mesh::load(const std::string& _file) {
             //  (proceed replacing the data on mesh)
             //
             clear();
-            addColors(colors);
-            addVertices(vertices);
-            addTexCoords(texcoord);
-            addIndices(indices);
+            addColors(std::move(colors));
+            addVertices(std::move(vertices));
+            addTexCoords(std::move(texcoord));
+            addIndices(std::move(indices));
 
             if(normals.size()>0 && ( getDrawMode() == GL_TRIANGLES || getDrawMode() == GL_TRIANGLE_STRIP)){
-                addNormals(normals);
+                addNormals(std::move(normals));
             } else {
                 computeNormals();
             }
@@ -265,51 +271,16 @@ bool Mesh::load(const std::string& _file) {
         std::cout << "ERROR glMesh, can not load  " << _file << std::endl;
         return false;
     } else if ( haveExt(_file,"obj") || haveExt(_file,"OBJ") ) {
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string err = tinyobj::LoadObj(shapes, materials, _file.c_str(), NULL);
-        if (!err.empty()) {
-            std::cerr << err << std::endl;
-            return false;
-        }
-
-        for (size_t i = 0; i < shapes.size(); i++) {
-            if ((shapes[i].mesh.positions.size() % 3) == 0) {
-                for (size_t v = 0; v < shapes[i].mesh.positions.size() / 3; v++) {
-                    addVertex(glm::vec3(shapes[i].mesh.positions[3*v+0],
-                                        shapes[i].mesh.positions[3*v+1],
-                                        shapes[i].mesh.positions[3*v+2]));
-                }
-            }
-
-            if ( (shapes[i].mesh.normals.size() % 3) == 0) {
-                for (size_t v = 0; v < shapes[i].mesh.normals.size() / 3; v++) {
-                    addNormal(glm::vec3(shapes[i].mesh.normals[3*v+0],
-                                        shapes[i].mesh.normals[3*v+1],
-                                        shapes[i].mesh.normals[3*v+2]));
-                }
-            }
-
-            if ( (shapes[i].mesh.texcoords.size() % 2) == 0) {
-                for (size_t v = 0; v < shapes[i].mesh.texcoords.size() / 2; v++) {
-                    addTexCoord(glm::vec2(  shapes[i].mesh.texcoords[2*v+0],
-                                            shapes[i].mesh.texcoords[2*v+1] ));
-                }
-            }
-
-            if ( (shapes[i].mesh.indices.size() % 3) == 0) {
-                for (size_t f = 0; f < shapes[i].mesh.indices.size() / 3; f++) {
-                    addTriangle(shapes[i].mesh.indices[3*f+0], shapes[i].mesh.indices[3*f+1],shapes[i].mesh.indices[3*f+2]);
-                }
-            }
-
-        }
+        return loadOBJ(_file, *this);
     }
     return false;
 }
 
 bool Mesh::save(const std::string& _file, bool _useBinary) {
-    if (haveExt(_file,"ply")){
+    if (haveExt(_file,"glsv")) {
+        return MeshCache::save(_file, *this);
+    }
+    else if (haveExt(_file,"ply")){
         std::ios_base::openmode binary_mode = _useBinary ? std::ios::binary : (std::ios_base::openmode)0;
         std::fstream os(_file.c_str(), std::ios::out | binary_mode);
 
@@ -440,6 +411,15 @@ void Mesh::addColors(const std::vector<glm::vec4> &_colors) {
     m_colors.insert(m_colors.end(), _colors.begin(), _colors.end());
 }
 
+void Mesh::addColors(std::vector<glm::vec4> &&_colors) {
+    if (m_colors.empty()) {
+        m_colors = std::move(_colors);
+    }
+    else {
+        addColors(_colors);
+    }
+}
+
 void Mesh::addVertex(const glm::vec3 &_point){
    m_vertices.push_back(_point);
 }
@@ -452,6 +432,15 @@ void Mesh::addVertices(const glm::vec3* verts, int amt){
    m_vertices.insert(m_vertices.end(),verts,verts+amt);
 }
 
+void Mesh::addVertices(std::vector<glm::vec3> &&_verts){
+    if (m_vertices.empty()) {
+        m_vertices = std::move(_verts);
+    }
+    else {
+        addVertices(_verts);
+    }
+}
+
 void Mesh::addNormal(const glm::vec3 &_normal){
     m_normals.push_back(_normal);
 }
@@ -460,6 +449,15 @@ void Mesh::addNormals(const std::vector<glm::vec3> &_normals ){
     m_normals.insert(m_normals.end(), _normals.begin(), _normals.end());
 }
 
+void Mesh::addNormals(std::vector<glm::vec3> &&_normals ){
+    if (m_normals.empty()) {
+        m_normals = std::move(_normals);
+    }
+    else {
+        addNormals(_normals);
+    }
+}
+
 void Mesh::addTexCoord(const glm::vec2 &_uv){
     m_texCoords.push_back(_uv);
 }
@@ -468,19 +466,37 @@ void Mesh::addTexCoords(const std::vector<glm::vec2> &_uvs){
     m_texCoords.insert(m_texCoords.end(), _uvs.begin(), _uvs.end());
 }
 
-void Mesh::addIndex(uint16_t _i){
+void Mesh::addTexCoords(std::vector<glm::vec2> &&_uvs){
+    if (m_texCoords.empty()) {
+        m_texCoords = std::move(_uvs);
+    }
+    else {
+        addTexCoords(_uvs);
+    }
+}
+
+void Mesh::addIndex(INDEX_TYPE _i){
     m_indices.push_back(_i);
 }
 
-void Mesh::addIndices(const std::vector<uint16_t>& inds){
+void Mesh::addIndices(const std::vector<INDEX_TYPE>& inds){
 	m_indices.insert(m_indices.end(),inds.begin(),inds.end());
 }
 
-void Mesh::addIndices(const uint16_t* inds, int amt){
+void Mesh::addIndices(const INDEX_TYPE* inds, int amt){
 	m_indices.insert(m_indices.end(),inds,inds+amt);
 }
 
-void Mesh::addTriangle(uint16_t index1, uint16_t index2, uint16_t index3){
+void Mesh::addIndices(std::vector<INDEX_TYPE> &&inds){
+    if (m_indices.empty()) {
+        m_indices = std::move(inds);
+    }
+    else {
+        addIndices(inds);
+    }
+}
+
+void Mesh::addTriangle(INDEX_TYPE index1, INDEX_TYPE index2, INDEX_TYPE index3){
     addIndex(index1);
     addIndex(index2);
     addIndex(index3);
@@ -493,7 +509,7 @@ void Mesh::add(const Mesh &_mesh){
         return;
     }
 
-    uint16_t indexOffset = (uint16_t)getVertices().size();
+    INDEX_TYPE indexOffset = (INDEX_TYPE)getVertices().size();
 
     addColors(_mesh.getColors());
     addVertices(_mesh.getVertices());
@@ -525,7 +541,7 @@ const std::vector<glm::vec2> & Mesh::getTexCoords() const{
     return m_texCoords;
 }
 
-const std::vector<uint16_t> & Mesh::getIndices() const{
+const std::vector<INDEX_TYPE> & Mesh::getIndices() const{
     return m_indices;
 }
 
@@ -569,51 +585,22 @@ void Mesh::clear(){
 	if(!m_normals.empty()){
 		m_normals.clear();
 	}
+	if(!m_texCoords.empty()){
+		m_texCoords.clear();
+	}
     if(!m_indices.empty()){
 		m_indices.clear();
 	}
+	m_lods.clear();
 }
 
 void Mesh::computeNormals(){
 
     if(getDrawMode() == GL_TRIANGLES){
-        //The number of the vertices
-        int nV = m_vertices.size();
-
-        //The number of the triangles
-        int nT = m_indices.size() / 3;
-
-        std::vector<glm::vec3> norm( nV ); //Array for the normals
-
-        //Scan all the triangles. For each triangle add its
-        //normal to norm's vectors of triangle's vertices
-        for (int t=0; t<nT; t++) {
-
-            //Get indices of the triangle t
-            int i1 = m_indices[ 3 * t ];
-            int i2 = m_indices[ 3 * t + 1 ];
-            int i3 = m_indices[ 3 * t + 2 ];
-
-            //Get vertices of the triangle
-            const glm::vec3 &v1 = m_vertices[ i1 ];
-            const glm::vec3 &v2 = m_vertices[ i2 ];
-            const glm::vec3 &v3 = m_vertices[ i3 ];
-
-            //Compute the triangle's normal
-            glm::vec3 dir = glm::normalize(glm::cross(v2-v1,v3-v1));
-
-            //Accumulate it to norm array for i1, i2, i3
-            norm[ i1 ] += dir;
-            norm[ i2 ] += dir;
-            norm[ i3 ] += dir;
-        }
-
-        //Normalize the normal's length and add it.
+        std::vector<glm::vec3> normals;
+        computeVertexNormals(m_vertices, m_indices, normals);
         m_normals.clear();
-        for (int i=0; i<nV; i++) {
-            addNormal( glm::normalize(norm[i]) );
-        }
-
+        addNormals(std::move(normals));
     } else {
         //  TODO
         //
@@ -621,61 +608,150 @@ void Mesh::computeNormals(){
     }
 }
 
-Vbo* Mesh::getVbo() {
+bool Mesh::hasColors() const {
+    return m_colors.size() > 0 && m_colors.size() == m_vertices.size();
+}
+
+bool Mesh::hasNormals() const {
+    return m_normals.size() > 0 && m_normals.size() == m_vertices.size();
+}
+
+bool Mesh::hasTexCoords() const {
+    return m_texCoords.size() > 0 && m_texCoords.size() == m_vertices.size();
+}
 
-    // Create Vertex Layout
-    //
+VertexLayout* Mesh::getVertexLayout(bool _colors, bool _normals, bool _texCoords) {
     std::vector<VertexLayout::VertexAttrib> attribs;
     attribs.push_back({"position", 3, GL_FLOAT, POSITION_ATTRIBUTE, false, 0});
-    int  nBits = 3;
 
-    bool bColor = false;
-    if (getColors().size() > 0 && getColors().size() == m_vertices.size()){
+    if (_colors) {
         attribs.push_back({"color", 4, GL_FLOAT, COLOR_ATTRIBUTE, false, 0});
-        bColor = true;
-        nBits += 4;
     }
 
-    bool bNormals = false;
-    if (getNormals().size() > 0 && getNormals().size() == m_vertices.size()){
+    if (_normals) {
         attribs.push_back({"normal", 3, GL_FLOAT, NORMAL_ATTRIBUTE, false, 0});
-        bNormals = true;
-        nBits += 3;
     }
 
-    bool bTexCoords = false;
-    if (getTexCoords().size() > 0 && getTexCoords().size() == m_vertices.size()){
+    if (_texCoords) {
         attribs.push_back({"texcoord", 2, GL_FLOAT, TEXCOORD_ATTRIBUTE, false, 0});
-        bTexCoords = true;
-        nBits += 2;
     }
 
-    VertexLayout* vertexLayout = new VertexLayout(attribs);
-    Vbo* tmpMesh = new Vbo(vertexLayout);
-    tmpMesh->setDrawMode(getDrawMode());
+    return new VertexLayout(attribs);
+}
 
-    std::vector<GLfloat> data;
-    for(uint i = 0; i < m_vertices.size(); i++){
-        data.push_back(m_vertices[i].x);
-        data.push_back(m_vertices[i].y);
-        data.push_back(m_vertices[i].z);
-        if(bColor){
-            data.push_back(m_colors[i].r);
-            data.push_back(m_colors[i].g);
-            data.push_back(m_colors[i].b);
-            data.push_back(m_colors[i].a);
+VertexLayout* Mesh::getVertexLayout() const {
+    return getVertexLayout(hasColors(), hasNormals(), hasTexCoords());
+}
+
+std::vector<GLfloat> Mesh::getVertexData() const {
+    bool bColor = hasColors();
+    bool bNormals = hasNormals();
+    bool bTexCoords = hasTexCoords();
+
+    size_t nFloats = 3;
+    if (bColor) nFloats += 4;
+    if (bNormals) nFloats += 3;
+    if (bTexCoords) nFloats += 2;
+
+    std::vector<GLfloat> data(m_vertices.size() * nFloats);
+
+    // Interleave position, color, normal and texcoord of each vertex
+    parallelFor(m_vertices.size(), [&](size_t _begin, size_t _end) {
+        GLfloat* dst = data.data() + _begin * nFloats;
+        for (size_t i = _begin; i < _end; i++) {
+            *dst++ = m_vertices[i].x;
+            *dst++ = m_vertices[i].y;
+            *dst++ = m_vertices[i].z;
+            if (bColor) {
+                *dst++ = m_colors[i].r;
+                *dst++ = m_colors[i].g;
+                *dst++ = m_colors[i].b;
+                *dst++ = m_colors[i].a;
+            }
+            if (bNormals) {
+                *dst++ = m_normals[i].x;
+                *dst++ = m_normals[i].y;
+                *dst++ = m_normals[i].z;
+            }
+            if (bTexCoords) {
+                *dst++ = m_texCoords[i].x;
+                *dst++ = m_texCoords[i].y;
+            }
         }
-        if(bNormals){
-            data.push_back(m_normals[i].x);
-            data.push_back(m_normals[i].y);
-            data.push_back(m_normals[i].z);
+    }, 65536);
+
+    return data;
+}
+
+template <class T>
+void remapVertexAttribute(std::vector<T> &_attribute, const std::vector<INDEX_TYPE> &_remap) {
+    if (_attribute.size() != _remap.size()) {
+        return;
+    }
+
+    std::vector<T> remapped(_attribute.size());
+    for (size_t i = 0; i < _remap.size(); i++) {
+        remapped[_remap[i]] = _attribute[i];
+    }
+    _attribute.swap(remapped);
+}
+
+bool Mesh::optimize(bool _overdraw) {
+    if (getDrawMode() != GL_TRIANGLES || m_indices.size() < 3) {
+        std::cout << "ERROR: Mesh only optimize indexed GL_TRIANGLES" << std::endl;
+        return false;
+    }
+
+    std::vector<size_t> clusters = optimizeVertexCache(m_indices, m_vertices.size());
+
+    if (_overdraw) {
+        optimizeOverdraw(m_indices, m_vertices, clusters);
+    }
+
+    std::vector<INDEX_TYPE> remap = optimizeVertexFetch(m_indices, m_vertices.size());
+    for (size_t l = 0; l < m_lods.size(); l++) {
+        optimizeVertexCache(m_lods[l], m_vertices.size());
+        for (size_t i = 0; i < m_lods[l].size(); i++) {
+            m_lods[l][i] = remap[ m_lods[l][i] ];
         }
-        if(bTexCoords){
-            data.push_back(m_texCoords[i].x);
-            data.push_back(m_texCoords[i].y);
+    }
+    remapVertexAttribute(m_vertices, remap);
+    remapVertexAttribute(m_colors, remap);
+    remapVertexAttribute(m_normals, remap);
+    remapVertexAttribute(m_texCoords, remap);
+
+    return true;
+}
+
+bool Mesh::generateLods(int _levels) {
+    m_lods.clear();
+
+    if (getDrawMode() != GL_TRIANGLES || m_indices.size() < 3) {
+        std::cout << "ERROR: Mesh only generate levels of detail for indexed GL_TRIANGLES" << std::endl;
+        return false;
+    }
+
+    for (int l = 1; l < _levels; l++) {
+        const std::vector<INDEX_TYPE> &previous = (l == 1)? m_indices : m_lods.back();
+        size_t target = (size_t)(previous.size() / 3 * MESH_LOD_RATIO) * 3;
+
+        std::vector<INDEX_TYPE> lod = simplifyMesh(m_vertices, previous, target);
+
+        // Stop when borders and seams keep the mesh from getting any simpler
+        if (lod.size() < 3 || lod.size() > previous.size() * 0.8) {
+            break;
         }
+        m_lods.push_back( std::move(lod) );
     }
 
+    return m_lods.size() > 0;
+}
+
+Vbo* Mesh::getVbo() {
+    Vbo* tmpMesh = new Vbo(getVertexLayout());
+    tmpMesh->setDrawMode(getDrawMode());
+
+    std::vector<GLfloat> data = getVertexData();
     tmpMesh->addVertices((GLbyte*)data.data(), m_vertices.size());
 
     if(getIndices().size()==0){
@@ -693,5 +769,15 @@ Vbo* Mesh::getVbo() {
 
     tmpMesh->addIndices(m_indices.data(), m_indices.size());
 
+    if (m_lods.size() > 0) {
+        std::vector<int> offsets;
+        offsets.push_back(0);
+        for (size_t l = 0; l < m_lods.size(); l++) {
+            offsets.push_back( tmpMesh->numIndices() );
+            tmpMesh->addIndices(m_lods[l].data(), m_lods[l].size());
+        }
+        tmpMesh->setLodOffsets(offsets);
+    }
+
     return tmpMesh;
 }
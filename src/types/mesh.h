@@ -6,6 +6,7 @@
 #include "glm/glm.hpp"
 
 #include "../gl/vbo.h"
+#include "meshSimplify.h"
 
 class Mesh {
 public:
@@ -22,22 +23,27 @@ public:
     void    setColor(const glm::vec4 &_color);
     void    addColor(const glm::vec4 &_color);
     void    addColors(const std::vector<glm::vec4> &_colors);
+    void    addColors(std::vector<glm::vec4> &&_colors);
 
     void    addVertex(const glm::vec3 &_point);
     void    addVertices(const std::vector<glm::vec3>& _verts);
     void    addVertices(const glm::vec3* _verts, int _amt);
+    void    addVertices(std::vector<glm::vec3> &&_verts);
 
     void    addNormal(const glm::vec3 &_normal);
     void    addNormals(const std::vector<glm::vec3> &_normals );
+    void    addNormals(std::vector<glm::vec3> &&_normals );
 
     void    addTexCoord(const glm::vec2 &_uv);
     void    addTexCoords(const std::vector<glm::vec2> &_uvs);
+    void    addTexCoords(std::vector<glm::vec2> &&_uvs);
 
-    void    addIndex(uint16_t _i);
-    void    addIndices(const std::vector<uint16_t>& _inds);
-    void    addIndices(const uint16_t* _inds, int _amt);
+    void    addIndex(INDEX_TYPE _i);
+    void    addIndices(const std::vector<INDEX_TYPE>& _inds);
+    void    addIndices(const INDEX_TYPE* _inds, int _amt);
+    void    addIndices(std::vector<INDEX_TYPE> &&_inds);
 
-    void    addTriangle(uint16_t index1, uint16_t index2, uint16_t index3);
+    void    addTriangle(INDEX_TYPE index1, INDEX_TYPE index2, INDEX_TYPE index3);
 
     void    add(const Mesh &_mesh);
 
@@ -48,11 +54,30 @@ public:
     const std::vector<glm::vec3> & getVertices() const;
     const std::vector<glm::vec3> & getNormals() const;
     const std::vector<glm::vec2> & getTexCoords() const;
-    const std::vector<uint16_t>  & getIndices() const;
+    const std::vector<INDEX_TYPE>  & getIndices() const;
+
+    bool    hasColors() const;
+    bool    hasNormals() const;
+    bool    hasTexCoords() const;
+
+    //  Layout of the interleaved vertex data returned by getVertexData()
+    static VertexLayout* getVertexLayout(bool _colors, bool _normals, bool _texCoords);
+    VertexLayout*   getVertexLayout() const;
+    std::vector<GLfloat> getVertexData() const;
 
     Vbo*    getVbo();
 
     void    computeNormals();
+
+    //  Reorder triangles for vertex cache locality (and optionally to reduce overdraw)
+    //  and vertices for fetch locality. Only for indexed GL_TRIANGLES.
+    bool    optimize(bool _overdraw = false);
+
+    //  Simplified versions of the triangles sharing the same vertices. Level 0 is getIndices(),
+    //  getLods()[0] is level 1 and so on. Only for indexed GL_TRIANGLES.
+    bool    generateLods(int _levels = MESH_LOD_LEVELS);
+    const std::vector< std::vector<INDEX_TYPE> > & getLods() const { return m_lods; };
+
     void    clear();
 
 private:
@@ -60,7 +85,8 @@ private:
     std::vector<glm::vec3>  m_vertices;
     std::vector<glm::vec3>  m_normals;
     std::vector<glm::vec2>  m_texCoords;
-    std::vector<uint16_t>   m_indices;
+    std::vector<INDEX_TYPE>   m_indices;
+    std::vector< std::vector<INDEX_TYPE> > m_lods;
 
     GLenum    m_drawMode;
 };
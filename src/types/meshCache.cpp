@@ -0,0 +1,194 @@
+#include "meshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tools/geomKernels.h"
+
+MeshCache::MeshCache(): m_data(nullptr), m_size(0), m_header(nullptr) {
+}
+
+MeshCache::~MeshCache() {
+    close();
+}
+
+bool MeshCache::open(const std::string& _file) {
+    close();
+
+    int fd = ::open(_file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeshCacheHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    m_data = data;
+    m_size = st.st_size;
+    m_header = (const MeshCacheHeader*)m_data;
+
+    uint32_t stride = 3;
+    if (m_header->flags & MESHCACHE_COLORS) stride += 4;
+    if (m_header->flags & MESHCACHE_NORMALS) stride += 3;
+    if (m_header->flags & MESHCACHE_TEXCOORDS) stride += 2;
+    stride *= sizeof(GLfloat);
+
+    if (m_header->magic != MESHCACHE_MAGIC ||
+        m_header->version != MESHCACHE_VERSION ||
+        m_header->indexSize != sizeof(INDEX_TYPE) ||
+        m_header->stride != stride ||
+        m_header->nLods == 0 ||
+        m_size < sizeof(MeshCacheHeader) + m_header->nVertices * m_header->stride + m_header->nIndices * m_header->indexSize + m_header->nLods * sizeof(uint64_t)) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::close() {
+    if (m_data) {
+        munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+}
+
+bool MeshCache::isUpToDate(const std::string& _source) const {
+    if (!isOpen()) {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(_source.c_str(), &st) != 0) {
+        return false;
+    }
+
+    return  m_header->sourceSize == (uint64_t)st.st_size &&
+            m_header->sourceTime == (int64_t)st.st_mtime;
+}
+
+glm::vec3 MeshCache::getCentroid() const {
+    if (!isOpen()) {
+        return glm::vec3(0.0);
+    }
+    return glm::vec3(m_header->centroid[0], m_header->centroid[1], m_header->centroid[2]);
+}
+
+Vbo* MeshCache::getVbo() const {
+    if (!isOpen()) {
+        return nullptr;
+    }
+
+    VertexLayout* layout = Mesh::getVertexLayout( m_header->flags & MESHCACHE_COLORS,
+                                                  m_header->flags & MESHCACHE_NORMALS,
+                                                  m_header->flags & MESHCACHE_TEXCOORDS );
+    Vbo* vbo = new Vbo(layout, m_header->drawMode);
+
+    const GLbyte* vertices = (const GLbyte*)m_data + sizeof(MeshCacheHeader);
+    const INDEX_TYPE* indices = (const INDEX_TYPE*)(vertices + m_header->nVertices * m_header->stride);
+    vbo->upload(vertices, m_header->nVertices, indices, m_header->nIndices);
+
+    if (m_header->nLods > 1) {
+        // The table may not be 8 bytes aligned after 16 bits indices
+        std::vector<uint64_t> lods(m_header->nLods);
+        memcpy(lods.data(), indices + m_header->nIndices, m_header->nLods * sizeof(uint64_t));
+        vbo->setLodOffsets( std::vector<int>(lods.begin(), lods.end()) );
+    }
+
+    return vbo;
+}
+
+bool MeshCache::save(const std::string& _file, const Mesh& _mesh, const std::string& _source, uint32_t _flags) {
+    const std::vector<glm::vec3>& vertices = _mesh.getVertices();
+    const std::vector<INDEX_TYPE>& indices = _mesh.getIndices();
+    const std::vector< std::vector<INDEX_TYPE> >& lods = _mesh.getLods();
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(MeshCacheHeader));
+    header.magic = MESHCACHE_MAGIC;
+    header.version = MESHCACHE_VERSION;
+    header.flags = _flags & MESHCACHE_PASSES;
+    if (_mesh.hasColors()) header.flags |= MESHCACHE_COLORS;
+    if (_mesh.hasNormals()) header.flags |= MESHCACHE_NORMALS;
+    if (_mesh.hasTexCoords()) header.flags |= MESHCACHE_TEXCOORDS;
+    header.drawMode = _mesh.getDrawMode();
+    header.indexSize = sizeof(INDEX_TYPE);
+    header.nVertices = vertices.size();
+    header.nLods = 1 + lods.size();
+
+    std::vector<uint64_t> lodOffsets;
+    lodOffsets.push_back(0);
+    header.nIndices = indices.size();
+    for (size_t l = 0; l < lods.size(); l++) {
+        lodOffsets.push_back(header.nIndices);
+        header.nIndices += lods[l].size();
+    }
+
+    VertexLayout* layout = _mesh.getVertexLayout();
+    header.stride = layout->getStride();
+    delete layout;
+
+    if (_source != "") {
+        struct stat st;
+        if (stat(_source.c_str(), &st) == 0) {
+            header.sourceSize = st.st_size;
+            header.sourceTime = st.st_mtime;
+        }
+    }
+
+    GeomBounds bounds = computeBounds(vertices);
+    for (int i = 0; i < 3; i++) {
+        header.centroid[i] = bounds.centroid[i];
+        header.min[i] = bounds.min[i];
+        header.max[i] = bounds.max[i];
+    }
+
+    std::vector<GLfloat> data = _mesh.getVertexData();
+
+    // Write to a temporary file and move it in place, so a running instance never maps a half written cache
+    std::string tmpFile = _file + ".tmp";
+    std::ofstream os(tmpFile.c_str(), std::ios::out | std::ios::binary);
+    if (!os.is_open()) {
+        std::cout << "ERROR MeshCache, can not write " << _file << std::endl;
+        return false;
+    }
+
+    os.write((const char*)&header, sizeof(MeshCacheHeader));
+    os.write((const char*)data.data(), data.size() * sizeof(GLfloat));
+    os.write((const char*)indices.data(), indices.size() * sizeof(INDEX_TYPE));
+    for (size_t l = 0; l < lods.size(); l++) {
+        os.write((const char*)lods[l].data(), lods[l].size() * sizeof(INDEX_TYPE));
+    }
+    os.write((const char*)lodOffsets.data(), lodOffsets.size() * sizeof(uint64_t));
+    os.close();
+
+    if (!os || std::rename(tmpFile.c_str(), _file.c_str()) != 0) {
+        std::remove(tmpFile.c_str());
+        std::cout << "ERROR MeshCache, can not write " << _file << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::string MeshCache::getCachePath(const std::string& _source) {
+    return _source + ".glsv";
+}
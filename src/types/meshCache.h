@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "types/mesh.h"
+
+//  Binary mesh container (.glsv). A header followed by the vertex and index
+//  blobs already in the layout they are uploaded to the GPU with:
+//
+//      MeshCacheHeader | vertices (nVertices * stride bytes) | indices (nIndices * indexSize bytes) | lods (nLods * 8 bytes)
+//
+//  The indices hold every level of detail one after the other, lods is the first index of each level.
+//
+#define MESHCACHE_MAGIC     0x56534C47  // "GLSV"
+#define MESHCACHE_VERSION   2
+
+// Attributes interleaved on each vertex (position is always present)
+#define MESHCACHE_COLORS    (1<<0)
+#define MESHCACHE_NORMALS   (1<<1)
+#define MESHCACHE_TEXCOORDS (1<<2)
+
+// Passes the geometry went through before being stored
+#define MESHCACHE_OPTIMIZED (1<<3)  // vertex cache and fetch order
+#define MESHCACHE_OVERDRAW  (1<<4)  // overdraw cluster sorting
+#define MESHCACHE_LODS      (1<<5)  // levels of detail
+#define MESHCACHE_PASSES    (MESHCACHE_OPTIMIZED | MESHCACHE_OVERDRAW | MESHCACHE_LODS)
+
+struct MeshCacheHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    flags;
+    uint32_t    drawMode;
+    uint32_t    indexSize;      // bytes per index
+    uint32_t    stride;         // bytes per vertex
+    uint64_t    nVertices;
+    uint64_t    nIndices;
+    uint64_t    sourceSize;     // size and modification time of the file the cache was made from
+    int64_t     sourceTime;
+    float       centroid[3];
+    float       min[3];
+    float       max[3];
+    uint32_t    nLods;
+};
+
+class MeshCache {
+public:
+    MeshCache();
+    virtual ~MeshCache();
+
+    //  Map a cache file in memory
+    bool    open(const std::string& _file);
+    void    close();
+    bool    isOpen() const { return m_data != nullptr; };
+
+    //  True if the cache was made from the current version of _source
+    bool    isUpToDate(const std::string& _source) const;
+
+    const MeshCacheHeader& getHeader() const { return *m_header; };
+    glm::vec3   getCentroid() const;
+
+    //  Create a Vbo and upload the mapped blobs straight into GL buffers
+    Vbo*    getVbo() const;
+
+    //  Write _mesh as a cache. If _source is given its size and modification time
+    //  are stored so the cache can be invalidated when the source changes.
+    //  _flags records extra MESHCACHE_ passes applied to the mesh.
+    static bool save(const std::string& _file, const Mesh& _mesh, const std::string& _source = "", uint32_t _flags = 0);
+
+    //  Where the cache of a given source file lives
+    static std::string getCachePath(const std::string& _source);
+
+private:
+    void*   m_data;
+    size_t  m_size;
+
+    const MeshCacheHeader*  m_header;
+};
@@ -0,0 +1,212 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+
+float getACMR(const std::vector<INDEX_TYPE> &_indices, size_t _nVertices, unsigned int _cacheSize) {
+    size_t nTriangles = _indices.size() / 3;
+    if (nTriangles == 0) {
+        return 0.0;
+    }
+
+    // A vertex is in the FIFO while less than _cacheSize misses happened after it entered
+    std::vector<size_t> entered(_nVertices, 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < nTriangles * 3; i++) {
+        INDEX_TYPE v = _indices[i];
+        if (entered[v] == 0 || misses - entered[v] >= _cacheSize) {
+            misses++;
+            entered[v] = misses;
+        }
+    }
+
+    return float(misses) / float(nTriangles);
+}
+
+std::vector<size_t> optimizeVertexCache(std::vector<INDEX_TYPE> &_indices, size_t _nVertices, unsigned int _cacheSize) {
+    std::vector<size_t> clusters;
+    size_t nTriangles = _indices.size() / 3;
+    if (nTriangles == 0 || _nVertices == 0) {
+        return clusters;
+    }
+
+    // Vertex -> triangles adjacency
+    std::vector<unsigned int> live(_nVertices, 0);
+    for (size_t i = 0; i < nTriangles * 3; i++) {
+        live[_indices[i]]++;
+    }
+
+    std::vector<size_t> offsets(_nVertices + 1, 0);
+    for (size_t v = 0; v < _nVertices; v++) {
+        offsets[v+1] = offsets[v] + live[v];
+    }
+
+    std::vector<size_t> adjacency(offsets[_nVertices]);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < nTriangles; t++) {
+        for (int k = 0; k < 3; k++) {
+            adjacency[ fill[_indices[t*3+k]]++ ] = t;
+        }
+    }
+
+    std::vector<size_t> cacheTime(_nVertices, 0);
+    std::vector<bool> emitted(nTriangles, false);
+    std::vector<INDEX_TYPE> deadEnd;
+    std::vector<INDEX_TYPE> candidates;
+    std::vector<INDEX_TYPE> output;
+    output.reserve(nTriangles * 3);
+
+    size_t timeStamp = _cacheSize + 1;
+    size_t cursor = 0;
+    long fanning = 0;
+
+    clusters.push_back(0);
+    while (fanning >= 0) {
+        candidates.clear();
+
+        // Emit all the triangles around the fanning vertex
+        for (size_t a = offsets[fanning]; a < offsets[fanning+1]; a++) {
+            size_t t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+
+            for (int k = 0; k < 3; k++) {
+                INDEX_TYPE v = _indices[t*3+k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timeStamp - cacheTime[v] > _cacheSize) {
+                    cacheTime[v] = timeStamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Pick the next fanning vertex: the oldest candidate that will still be in
+        // the cache after emitting all its remaining triangles
+        long next = -1;
+        size_t best = 0;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            INDEX_TYPE v = candidates[c];
+            if (live[v] == 0) {
+                continue;
+            }
+
+            size_t priority = 0;
+            if (timeStamp - cacheTime[v] + 2 * live[v] <= _cacheSize) {
+                priority = timeStamp - cacheTime[v];
+            }
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        if (next == -1) {
+            // Dead end: go back through the recently used vertices and then through the input order
+            while (!deadEnd.empty() && next == -1) {
+                INDEX_TYPE v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                }
+            }
+
+            while (next == -1 && cursor < _nVertices) {
+                if (live[cursor] > 0) {
+                    next = cursor;
+                }
+                cursor++;
+            }
+
+            if (next != -1 && output.size() > clusters.back()) {
+                clusters.push_back(output.size());
+            }
+        }
+
+        fanning = next;
+    }
+
+    _indices.swap(output);
+    return clusters;
+}
+
+void optimizeOverdraw(std::vector<INDEX_TYPE> &_indices, const std::vector<glm::vec3> &_vertices, const std::vector<size_t> &_clusters) {
+    if (_clusters.size() < 2 || _vertices.empty()) {
+        return;
+    }
+
+    glm::vec3 meshCentroid = glm::vec3(0.0);
+    for (size_t i = 0; i < _vertices.size(); i++) {
+        meshCentroid += _vertices[i];
+    }
+    meshCentroid /= (float)_vertices.size();
+
+    struct Cluster {
+        size_t  begin;
+        size_t  end;
+        float   sort;
+    };
+    std::vector<Cluster> clusters(_clusters.size());
+
+    for (size_t c = 0; c < _clusters.size(); c++) {
+        clusters[c].begin = _clusters[c];
+        clusters[c].end = (c + 1 < _clusters.size())? _clusters[c+1] : _indices.size();
+
+        // Area weighted centroid and normal of the cluster
+        glm::vec3 centroid = glm::vec3(0.0);
+        glm::vec3 normal = glm::vec3(0.0);
+        float area = 0.0;
+        for (size_t i = clusters[c].begin; i + 2 < clusters[c].end; i += 3) {
+            const glm::vec3 &a = _vertices[_indices[i]];
+            const glm::vec3 &b = _vertices[_indices[i+1]];
+            const glm::vec3 &d = _vertices[_indices[i+2]];
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triArea = glm::length(n);
+            centroid += (a + b + d) * (triArea / 3.0f);
+            normal += n;
+            area += triArea;
+        }
+
+        if (area > 0.0) {
+            centroid /= area;
+        }
+
+        // How much the cluster faces away from the center of the mesh
+        clusters[c].sort = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &_a, const Cluster &_b) {
+        return _a.sort > _b.sort;
+    });
+
+    std::vector<INDEX_TYPE> output;
+    output.reserve(_indices.size());
+    for (size_t c = 0; c < clusters.size(); c++) {
+        output.insert(output.end(), _indices.begin() + clusters[c].begin, _indices.begin() + clusters[c].end);
+    }
+    _indices.swap(output);
+}
+
+std::vector<INDEX_TYPE> optimizeVertexFetch(std::vector<INDEX_TYPE> &_indices, size_t _nVertices) {
+    const INDEX_TYPE unused = (INDEX_TYPE)-1;
+    std::vector<INDEX_TYPE> remap(_nVertices, unused);
+
+    INDEX_TYPE next = 0;
+    for (size_t i = 0; i < _indices.size(); i++) {
+        INDEX_TYPE &v = _indices[i];
+        if (remap[v] == unused) {
+            remap[v] = next++;
+        }
+        v = remap[v];
+    }
+
+    for (size_t v = 0; v < _nVertices; v++) {
+        if (remap[v] == unused) {
+            remap[v] = next++;
+        }
+    }
+
+    return remap;
+}
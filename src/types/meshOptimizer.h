@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "gl/vbo.h"
+
+//  Post-transform vertex cache size assumed by the optimizer and the ACMR simulation
+#define MESHOPT_CACHE_SIZE 16
+
+//  Average Cache Miss Ratio: vertex shader invocations per triangle for a FIFO
+//  post-transform cache of _cacheSize entries (between 0.5 and 3.0, lower is better)
+float getACMR(const std::vector<INDEX_TYPE> &_indices, size_t _nVertices, unsigned int _cacheSize = MESHOPT_CACHE_SIZE);
+
+//  Reorder the triangles for vertex cache locality using Tipsify
+//  ("Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", Sander et al. 2007).
+//  Returns the offset (in indices) of each cluster, the points where the cache was flushed.
+std::vector<size_t> optimizeVertexCache(std::vector<INDEX_TYPE> &_indices, size_t _nVertices, unsigned int _cacheSize = MESHOPT_CACHE_SIZE);
+
+//  Sort the clusters returned by optimizeVertexCache so the ones facing outwards of
+//  the mesh are drawn first, reducing overdraw independently of the view direction.
+void optimizeOverdraw(std::vector<INDEX_TYPE> &_indices, const std::vector<glm::vec3> &_vertices, const std::vector<size_t> &_clusters);
+
+//  Renumber the vertices in the order they are first referenced by the triangles.
+//  Returns the new position of each vertex; unreferenced vertices are moved to the end.
+std::vector<INDEX_TYPE> optimizeVertexFetch(std::vector<INDEX_TYPE> &_indices, size_t _nVertices);
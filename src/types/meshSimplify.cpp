@@ -0,0 +1,283 @@
+#include "meshSimplify.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+//  Symmetric 4x4 matrix of the sum of squared distances to a set of planes
+struct Quadric {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+
+    void add(const Quadric &_q) {
+        a00 += _q.a00; a01 += _q.a01; a02 += _q.a02;
+        a11 += _q.a11; a12 += _q.a12; a22 += _q.a22;
+        b0 += _q.b0; b1 += _q.b1; b2 += _q.b2;
+        c += _q.c;
+    }
+
+    void addPlane(const glm::dvec3 &_n, double _d, double _weight) {
+        a00 += _weight * _n.x * _n.x; a01 += _weight * _n.x * _n.y; a02 += _weight * _n.x * _n.z;
+        a11 += _weight * _n.y * _n.y; a12 += _weight * _n.y * _n.z; a22 += _weight * _n.z * _n.z;
+        b0 += _weight * _n.x * _d; b1 += _weight * _n.y * _d; b2 += _weight * _n.z * _d;
+        c += _weight * _d * _d;
+    }
+
+    double error(const glm::vec3 &_p) const {
+        double x = _p.x, y = _p.y, z = _p.z;
+        double e =  a00 * x * x + a11 * y * y + a22 * z * z +
+                    2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                    2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return (e > 0.0)? e : 0.0;
+    }
+};
+
+struct Collapse {
+    INDEX_TYPE  from;
+    INDEX_TYPE  to;
+    double      cost;
+};
+
+uint64_t edgeKey(uint32_t _a, uint32_t _b) {
+    return (_a < _b)? ((uint64_t)_a << 32) | _b : ((uint64_t)_b << 32) | _a;
+}
+
+// Vertices with the same position get the same id
+std::vector<uint32_t> getPositionIds(const std::vector<glm::vec3> &_vertices) {
+    std::vector<uint32_t> order(_vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) {
+        return memcmp(&_vertices[_a], &_vertices[_b], sizeof(glm::vec3)) < 0;
+    });
+
+    std::vector<uint32_t> ids(_vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i > 0 && memcmp(&_vertices[order[i]], &_vertices[order[i-1]], sizeof(glm::vec3)) == 0) {
+            ids[order[i]] = ids[order[i-1]];
+        }
+        else {
+            ids[order[i]] = order[i];
+        }
+    }
+    return ids;
+}
+
+// Triangles do not flip when _from moves to _to
+bool isCollapseValid(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, const uint32_t* _begin, const uint32_t* _end, INDEX_TYPE _from, INDEX_TYPE _to) {
+    for (const uint32_t* t = _begin; t != _end; t++) {
+        const INDEX_TYPE* tri = &_indices[*t * 3];
+        if (tri[0] == _to || tri[1] == _to || tri[2] == _to) {
+            continue; // collapses to a line and goes away
+        }
+
+        glm::vec3 p[3], q[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = _vertices[tri[k]];
+            q[k] = (tri[k] == _from)? _vertices[_to] : p[k];
+        }
+
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+
+        // Reject turns of more than ~75 degrees
+        if (glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+std::vector<INDEX_TYPE> simplifyMesh(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, size_t _targetIndices) {
+    size_t nVertices = _vertices.size();
+    std::vector<INDEX_TYPE> result(_indices.begin(), _indices.begin() + (_indices.size() / 3) * 3);
+
+    if (nVertices == 0 || result.size() <= _targetIndices) {
+        return result;
+    }
+
+    std::vector<uint32_t> positions = getPositionIds(_vertices);
+
+    // Vertices that share a position with others sit on an attribute seam
+    std::vector<uint32_t> wedges(nVertices, 0);
+    for (size_t v = 0; v < nVertices; v++) {
+        wedges[ positions[v] ]++;
+    }
+
+    std::vector<bool> locked(nVertices, false);
+    for (size_t v = 0; v < nVertices; v++) {
+        locked[v] = wedges[ positions[v] ] > 1;
+    }
+
+    // Edges used by other than two triangles are borders (or non manifold)
+    std::vector<uint64_t> edges;
+    edges.reserve(result.size());
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            edges.push_back( edgeKey(positions[result[i + k]], positions[result[i + (k + 1) % 3]]) );
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i]) {
+            j++;
+        }
+        if (j - i != 2) {
+            locked[ edges[i] >> 32 ] = true;
+            locked[ edges[i] & 0xFFFFFFFF ] = true;
+        }
+        i = j;
+    }
+    for (size_t v = 0; v < nVertices; v++) {
+        locked[v] = locked[v] || locked[ positions[v] ];
+    }
+
+    // Area weighted plane quadrics, accumulated per position
+    std::vector<Quadric> quadrics(nVertices);
+    memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::dvec3 p0 = _vertices[result[i]];
+        glm::dvec3 n = glm::cross(glm::dvec3(_vertices[result[i + 1]]) - p0, glm::dvec3(_vertices[result[i + 2]]) - p0);
+        double area = glm::length(n);
+        if (area <= 0.0) {
+            continue;
+        }
+        n /= area;
+        for (int k = 0; k < 3; k++) {
+            quadrics[ positions[result[i + k]] ].addPlane(n, -glm::dot(n, p0), area);
+        }
+    }
+
+    std::vector<uint32_t> offsets(nVertices + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<INDEX_TYPE> remap(nVertices);
+    std::vector<bool> touched(nVertices);
+
+    // Each pass collapses a set of independent edges, cheapest first, then rebuilds the triangles
+    while (result.size() > _targetIndices) {
+        size_t nTriangles = result.size() / 3;
+
+        // Vertex -> triangles
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t i = 0; i < result.size(); i++) {
+            offsets[ result[i] + 1 ]++;
+        }
+        for (size_t v = 0; v < nVertices; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < nTriangles; t++) {
+            for (int k = 0; k < 3; k++) {
+                adjacency[ fill[result[t * 3 + k]]++ ] = t;
+            }
+        }
+
+        // Cheapest direction of every edge that can collapse
+        edges.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                edges.push_back( edgeKey(result[i + k], result[i + (k + 1) % 3]) );
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (size_t e = 0; e < edges.size(); e++) {
+            INDEX_TYPE a = edges[e] >> 32;
+            INDEX_TYPE b = edges[e] & 0xFFFFFFFF;
+            if (positions[a] == positions[b] || (locked[a] && locked[b])) {
+                continue;
+            }
+
+            Quadric q = quadrics[ positions[a] ];
+            q.add( quadrics[ positions[b] ] );
+
+            Collapse collapse;
+            collapse.cost = -1.0;
+            if (!locked[a]) {
+                collapse.from = a;
+                collapse.to = b;
+                collapse.cost = q.error(_vertices[b]);
+            }
+            if (!locked[b]) {
+                double cost = q.error(_vertices[a]);
+                if (collapse.cost < 0.0 || cost < collapse.cost) {
+                    collapse.from = b;
+                    collapse.to = a;
+                    collapse.cost = cost;
+                }
+            }
+            collapses.push_back(collapse);
+        }
+
+        std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse &_a, const Collapse &_b) {
+            return _a.cost < _b.cost;
+        });
+
+        for (size_t v = 0; v < nVertices; v++) {
+            remap[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Every collapse removes about two triangles
+        size_t removed = 0;
+        size_t toRemove = (result.size() - _targetIndices) / 3;
+        for (size_t c = 0; c < collapses.size() && removed < toRemove; c++) {
+            const Collapse &collapse = collapses[c];
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            const uint32_t* begin = &adjacency[0] + offsets[collapse.from];
+            const uint32_t* end = &adjacency[0] + offsets[collapse.from + 1];
+            if (!isCollapseValid(_vertices, result, begin, end, collapse.from, collapse.to)) {
+                continue;
+            }
+
+            // The neighbourhood changes, keep it out of other collapses in this pass
+            for (const uint32_t* t = begin; t != end; t++) {
+                const INDEX_TYPE* tri = &result[*t * 3];
+                for (int k = 0; k < 3; k++) {
+                    touched[tri[k]] = true;
+                }
+                if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+                    removed++;
+                }
+            }
+            touched[collapse.to] = true;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[ positions[collapse.to] ].add( quadrics[ positions[collapse.from] ] );
+        }
+
+        if (removed == 0) {
+            break;
+        }
+
+        size_t n = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            INDEX_TYPE a = remap[result[i]];
+            INDEX_TYPE b = remap[result[i + 1]];
+            INDEX_TYPE d = remap[result[i + 2]];
+            if (a != b && b != d && d != a) {
+                result[n++] = a;
+                result[n++] = b;
+                result[n++] = d;
+            }
+        }
+        result.resize(n);
+    }
+
+    return result;
+}
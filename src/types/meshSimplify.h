@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "gl/vbo.h"
+
+//  Levels of detail generated by Mesh::generateLods (including the full resolution one)
+//  and the fraction of triangles kept from one level to the next
+#define MESH_LOD_LEVELS 4
+#define MESH_LOD_RATIO  0.25
+
+//  Simplify the triangles in _indices down to about _targetIndices indices by collapsing edges
+//  in order of increasing quadric error ("Surface Simplification Using Quadric Error Metrics",
+//  Garland & Heckbert 1997). Collapses are half-edge: a vertex is merged into one of its
+//  neighbours instead of a new position, so the result indexes the same _vertices and can
+//  share their buffer. Vertices on borders or attribute seams are never moved.
+std::vector<INDEX_TYPE> simplifyMesh(const std::vector<glm::vec3> &_vertices, const std::vector<INDEX_TYPE> &_indices, size_t _targetIndices);
@@ -0,0 +1,540 @@
+#include "obj.h"
+
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "tools/parallel.h"
+
+// Don't bother splitting files in blocks smaller than this
+#define OBJ_MIN_BLOCK_SIZE (1<<20)
+
+namespace {
+
+// Zero based indices to a position, texcoord and normal (-1 when not present)
+struct ObjCorner {
+    int v, t, n;
+
+    bool operator==(const ObjCorner &_other) const {
+        return v == _other.v && t == _other.t && n == _other.n;
+    }
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner &_c) const {
+        size_t h = (size_t)_c.v * 73856093u;
+        h ^= (size_t)(_c.t + 1) * 19349663u;
+        h ^= (size_t)(_c.n + 1) * 83492791u;
+        return h;
+    }
+};
+
+struct ObjBlock {
+    const char* begin;
+    const char* end;
+
+    // Amount of elements declared in this block (first pass)
+    size_t  nLines;
+    size_t  nPositions;
+    size_t  nTexCoords;
+    size_t  nNormals;
+
+    // Amount of elements declared on all previous blocks
+    size_t  firstLine;
+    size_t  firstPosition;
+    size_t  firstTexCoord;
+    size_t  firstNormal;
+
+    // Parsed data (second pass)
+    std::vector<glm::vec3>  positions;
+    std::vector<glm::vec4>  colors;
+    std::vector<glm::vec2>  texcoords;
+    std::vector<glm::vec3>  normals;
+    std::vector<ObjCorner>  corners;    // three per triangle
+    size_t  nColors;
+
+    std::string error;
+    size_t  errorLine;
+};
+
+inline bool isBlank(char _c) {
+    return _c == ' ' || _c == '\t' || _c == '\r';
+}
+
+inline const char* skipBlanks(const char* _p, const char* _end) {
+    while (_p < _end && isBlank(*_p)) {
+        _p++;
+    }
+    return _p;
+}
+
+inline bool isLineEnd(const char* _p, const char* _end) {
+    return _p >= _end || *_p == '\n' || *_p == '#';
+}
+
+inline bool isDigit(char _c) {
+    return _c >= '0' && _c <= '9';
+}
+
+// Parse a float without going through the locale aware (and slow) strtof.
+// Returns nullptr when there is no number at _p
+const char* parseFloat(const char* _p, const char* _end, float &_value) {
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* start = _p;
+    bool negative = false;
+    if (_p < _end && (*_p == '-' || *_p == '+')) {
+        negative = (*_p == '-');
+        _p++;
+    }
+
+    double value = 0.0;
+    bool digits = false;
+    while (_p < _end && isDigit(*_p)) {
+        value = value * 10.0 + (*_p - '0');
+        digits = true;
+        _p++;
+    }
+
+    if (_p < _end && *_p == '.') {
+        _p++;
+        double fraction = 0.0;
+        int nDecimals = 0;
+        while (_p < _end && isDigit(*_p)) {
+            if (nDecimals < 22) {
+                fraction = fraction * 10.0 + (*_p - '0');
+                nDecimals++;
+            }
+            digits = true;
+            _p++;
+        }
+        value += fraction / powers[nDecimals];
+    }
+
+    if (!digits) {
+        // Things like "nan" or "inf", let the C library deal with them
+        char* stop = nullptr;
+        _value = std::strtof(start, &stop);
+        return (stop == start || stop > _end)? nullptr : stop;
+    }
+
+    if (_p < _end && (*_p == 'e' || *_p == 'E')) {
+        _p++;
+        bool negativeExp = false;
+        if (_p < _end && (*_p == '-' || *_p == '+')) {
+            negativeExp = (*_p == '-');
+            _p++;
+        }
+        int exponent = 0;
+        while (_p < _end && isDigit(*_p)) {
+            exponent = exponent * 10 + (*_p - '0');
+            _p++;
+        }
+        double scale = (exponent <= 22)? powers[exponent] : std::pow(10.0, exponent);
+        value = negativeExp? value / scale : value * scale;
+    }
+
+    _value = (float)(negative? -value : value);
+    return _p;
+}
+
+const char* parseInt(const char* _p, const char* _end, int &_value) {
+    bool negative = false;
+    if (_p < _end && (*_p == '-' || *_p == '+')) {
+        negative = (*_p == '-');
+        _p++;
+    }
+
+    if (_p >= _end || !isDigit(*_p)) {
+        return nullptr;
+    }
+
+    int value = 0;
+    while (_p < _end && isDigit(*_p)) {
+        value = value * 10 + (*_p - '0');
+        _p++;
+    }
+    _value = negative? -value : value;
+    return _p;
+}
+
+// Parse up to _max floats from the rest of the line, returns how many where found
+int parseFloats(const char* _p, const char* _eol, float* _values, int _max) {
+    int n = 0;
+    while (n < _max) {
+        _p = skipBlanks(_p, _eol);
+        if (isLineEnd(_p, _eol)) {
+            break;
+        }
+        _p = parseFloat(_p, _eol, _values[n]);
+        if (!_p) {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+// Resolve a one based (or negative relative) OBJ index into a zero based one
+inline bool resolveIndex(int _index, size_t _declared, size_t _total, int &_resolved) {
+    if (_index > 0) {
+        _resolved = _index - 1;
+    }
+    else if (_index < 0) {
+        _resolved = (int)_declared + _index;
+    }
+    else {
+        return false;
+    }
+    return _resolved >= 0 && (size_t)_resolved < _total;
+}
+
+// First pass: count lines and elements so every block knows where its indices start
+void countBlock(ObjBlock &_block) {
+    _block.nLines = _block.nPositions = _block.nTexCoords = _block.nNormals = 0;
+
+    const char* p = _block.begin;
+    while (p < _block.end) {
+        const char* eol = (const char*)memchr(p, '\n', _block.end - p);
+        if (!eol) {
+            eol = _block.end;
+        }
+
+        p = skipBlanks(p, eol);
+        if (eol - p > 1 && p[0] == 'v') {
+            if (isBlank(p[1])) {
+                _block.nPositions++;
+            }
+            else if (p[1] == 't' && eol - p > 2 && isBlank(p[2])) {
+                _block.nTexCoords++;
+            }
+            else if (p[1] == 'n' && eol - p > 2 && isBlank(p[2])) {
+                _block.nNormals++;
+            }
+        }
+
+        _block.nLines++;
+        p = (eol < _block.end)? eol + 1 : _block.end;
+    }
+}
+
+// Second pass: tokenize the block
+void parseBlock(ObjBlock &_block, size_t _totalPositions, size_t _totalTexCoords, size_t _totalNormals) {
+    _block.positions.reserve(_block.nPositions);
+    _block.colors.reserve(_block.nPositions);
+    _block.texcoords.reserve(_block.nTexCoords);
+    _block.normals.reserve(_block.nNormals);
+    _block.nColors = 0;
+
+    std::vector<ObjCorner> polygon;
+    size_t lineNum = _block.firstLine;
+
+    const char* p = _block.begin;
+    while (p < _block.end) {
+        const char* eol = (const char*)memchr(p, '\n', _block.end - p);
+        if (!eol) {
+            eol = _block.end;
+        }
+        lineNum++;
+
+        p = skipBlanks(p, eol);
+        if (eol - p > 1 && p[0] == 'v') {
+            float values[7];
+            if (isBlank(p[1])) {
+                // v x y z [w] or v x y z r g b [a]
+                int n = parseFloats(p + 1, eol, values, 7);
+                if (n < 3) {
+                    _block.error = "vertex position with less than 3 components";
+                    _block.errorLine = lineNum;
+                    return;
+                }
+                _block.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+                if (n >= 6) {
+                    _block.colors.push_back(glm::vec4(values[3], values[4], values[5], (n == 7)? values[6] : 1.0f));
+                    _block.nColors++;
+                }
+                else {
+                    _block.colors.push_back(glm::vec4(1.0));
+                }
+            }
+            else if (p[1] == 't' && eol - p > 2 && isBlank(p[2])) {
+                values[1] = 0.0f;
+                if (parseFloats(p + 2, eol, values, 2) < 1) {
+                    _block.error = "texture coordinate without components";
+                    _block.errorLine = lineNum;
+                    return;
+                }
+                _block.texcoords.push_back(glm::vec2(values[0], values[1]));
+            }
+            else if (p[1] == 'n' && eol - p > 2 && isBlank(p[2])) {
+                if (parseFloats(p + 2, eol, values, 3) < 3) {
+                    _block.error = "normal with less than 3 components";
+                    _block.errorLine = lineNum;
+                    return;
+                }
+                _block.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+            }
+        }
+        else if (eol - p > 1 && p[0] == 'f' && isBlank(p[1])) {
+            size_t declaredPositions = _block.firstPosition + _block.positions.size();
+            size_t declaredTexCoords = _block.firstTexCoord + _block.texcoords.size();
+            size_t declaredNormals = _block.firstNormal + _block.normals.size();
+
+            polygon.clear();
+            const char* q = p + 1;
+            while (true) {
+                q = skipBlanks(q, eol);
+                if (isLineEnd(q, eol)) {
+                    break;
+                }
+
+                ObjCorner corner = { -1, -1, -1 };
+                int index = 0;
+                q = parseInt(q, eol, index);
+                if (!q || !resolveIndex(index, declaredPositions, _totalPositions, corner.v)) {
+                    _block.error = "invalid vertex index";
+                    _block.errorLine = lineNum;
+                    return;
+                }
+
+                if (q < eol && *q == '/') {
+                    q++;
+                    if (q < eol && *q != '/') {
+                        q = parseInt(q, eol, index);
+                        if (!q || !resolveIndex(index, declaredTexCoords, _totalTexCoords, corner.t)) {
+                            _block.error = "invalid texture coordinate index";
+                            _block.errorLine = lineNum;
+                            return;
+                        }
+                    }
+
+                    if (q < eol && *q == '/') {
+                        q++;
+                        q = parseInt(q, eol, index);
+                        if (!q || !resolveIndex(index, declaredNormals, _totalNormals, corner.n)) {
+                            _block.error = "invalid normal index";
+                            _block.errorLine = lineNum;
+                            return;
+                        }
+                    }
+                }
+
+                polygon.push_back(corner);
+            }
+
+            // Triangulate as a fan
+            for (size_t i = 2; i < polygon.size(); i++) {
+                _block.corners.push_back(polygon[0]);
+                _block.corners.push_back(polygon[i-1]);
+                _block.corners.push_back(polygon[i]);
+            }
+        }
+        // o, g, s, l, p, usemtl and mtllib are ignored
+
+        p = (eol < _block.end)? eol + 1 : _block.end;
+    }
+}
+
+}
+
+bool loadOBJ(const std::string& _file, Mesh& _mesh) {
+    std::ifstream is(_file.c_str(), std::ios::in | std::ios::binary);
+    if (!is.is_open()) {
+        std::cout << "ERROR loadOBJ(): can not open " << _file << std::endl;
+        return false;
+    }
+
+    is.seekg(0, std::ios::end);
+    size_t size = (size_t)is.tellg();
+    is.seekg(0, std::ios::beg);
+
+    std::vector<char> data(size + 1);
+    is.read(data.data(), size);
+    is.close();
+    data[size] = '\0';
+
+    // Split the file in blocks of whole lines
+    size_t nBlocks = size / OBJ_MIN_BLOCK_SIZE;
+    if (nBlocks > getNumThreads()) {
+        nBlocks = getNumThreads();
+    }
+    if (nBlocks < 1) {
+        nBlocks = 1;
+    }
+
+    const char* begin = data.data();
+    const char* end = begin + size;
+
+    std::vector<ObjBlock> blocks(nBlocks);
+    const char* blockBegin = begin;
+    for (size_t i = 0; i < nBlocks; i++) {
+        const char* blockEnd = end;
+        if (i + 1 < nBlocks) {
+            blockEnd = begin + (size * (i + 1)) / nBlocks;
+            if (blockEnd < blockBegin) {
+                blockEnd = blockBegin;
+            }
+            const char* eol = (const char*)memchr(blockEnd, '\n', end - blockEnd);
+            blockEnd = eol? eol + 1 : end;
+        }
+        blocks[i].begin = blockBegin;
+        blocks[i].end = blockEnd;
+        blockBegin = blockEnd;
+    }
+
+    parallelFor(blocks.size(), [&](size_t _begin, size_t _end) {
+        for (size_t i = _begin; i < _end; i++) {
+            countBlock(blocks[i]);
+        }
+    });
+
+    size_t totalPositions = 0, totalTexCoords = 0, totalNormals = 0, totalLines = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].firstLine = totalLines;
+        blocks[i].firstPosition = totalPositions;
+        blocks[i].firstTexCoord = totalTexCoords;
+        blocks[i].firstNormal = totalNormals;
+        totalLines += blocks[i].nLines;
+        totalPositions += blocks[i].nPositions;
+        totalTexCoords += blocks[i].nTexCoords;
+        totalNormals += blocks[i].nNormals;
+    }
+
+    parallelFor(blocks.size(), [&](size_t _begin, size_t _end) {
+        for (size_t i = _begin; i < _end; i++) {
+            parseBlock(blocks[i], totalPositions, totalTexCoords, totalNormals);
+        }
+    });
+
+    size_t totalCorners = 0;
+    size_t totalColors = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (!blocks[i].error.empty()) {
+            std::cout << "ERROR loadOBJ(): " << _file << ":" << blocks[i].errorLine << ": " << blocks[i].error << std::endl;
+            return false;
+        }
+        totalCorners += blocks[i].corners.size();
+        totalColors += blocks[i].nColors;
+    }
+
+    if (totalCorners == 0) {
+        std::cout << "ERROR loadOBJ(): " << _file << " has no faces" << std::endl;
+        return false;
+    }
+
+    // Gather the attribute pools
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec4> colors;
+    std::vector<glm::vec2> texcoords;
+    std::vector<glm::vec3> normals;
+    positions.reserve(totalPositions);
+    texcoords.reserve(totalTexCoords);
+    normals.reserve(totalNormals);
+    bool bColors = (totalColors == totalPositions);
+    if (bColors) {
+        colors.reserve(totalPositions);
+    }
+    for (size_t i = 0; i < blocks.size(); i++) {
+        positions.insert(positions.end(), blocks[i].positions.begin(), blocks[i].positions.end());
+        texcoords.insert(texcoords.end(), blocks[i].texcoords.begin(), blocks[i].texcoords.end());
+        normals.insert(normals.end(), blocks[i].normals.begin(), blocks[i].normals.end());
+        if (bColors) {
+            colors.insert(colors.end(), blocks[i].colors.begin(), blocks[i].colors.end());
+        }
+    }
+
+    bool bTexCoords = totalTexCoords > 0;
+    bool bNormals = totalNormals > 0;
+
+    std::vector<INDEX_TYPE> indices(totalCorners);
+    std::vector<glm::vec3> outPositions;
+    std::vector<glm::vec4> outColors;
+    std::vector<glm::vec2> outTexCoords;
+    std::vector<glm::vec3> outNormals;
+
+    if (!bTexCoords && !bNormals) {
+        // Nothing to deduplicate, positions can be indexed directly
+        std::vector<size_t> offsets(blocks.size(), 0);
+        for (size_t i = 1; i < blocks.size(); i++) {
+            offsets[i] = offsets[i-1] + blocks[i-1].corners.size();
+        }
+
+        parallelFor(blocks.size(), [&](size_t _begin, size_t _end) {
+            for (size_t i = _begin; i < _end; i++) {
+                INDEX_TYPE* dst = &indices[offsets[i]];
+                for (size_t c = 0; c < blocks[i].corners.size(); c++) {
+                    dst[c] = (INDEX_TYPE)blocks[i].corners[c].v;
+                }
+            }
+        });
+
+        outPositions = std::move(positions);
+        outColors = std::move(colors);
+    }
+    else {
+        // Each unique position/texcoord/normal tuple becomes one vertex
+        std::unordered_map<ObjCorner, INDEX_TYPE, ObjCornerHash> unique;
+        unique.reserve(totalPositions + totalPositions / 2);
+        outPositions.reserve(totalPositions);
+        if (bColors) {
+            outColors.reserve(totalPositions);
+        }
+        if (bTexCoords) {
+            outTexCoords.reserve(totalPositions);
+        }
+        if (bNormals) {
+            outNormals.reserve(totalPositions);
+        }
+
+        size_t n = 0;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            for (size_t c = 0; c < blocks[i].corners.size(); c++) {
+                const ObjCorner &corner = blocks[i].corners[c];
+                std::pair<std::unordered_map<ObjCorner, INDEX_TYPE, ObjCornerHash>::iterator, bool> found;
+                found = unique.insert(std::make_pair(corner, (INDEX_TYPE)outPositions.size()));
+
+                if (found.second) {
+                    outPositions.push_back(positions[corner.v]);
+                    if (bColors) {
+                        outColors.push_back(colors[corner.v]);
+                    }
+                    if (bTexCoords) {
+                        outTexCoords.push_back( (corner.t >= 0)? texcoords[corner.t] : glm::vec2(0.0) );
+                    }
+                    if (bNormals) {
+                        outNormals.push_back( (corner.n >= 0)? normals[corner.n] : glm::vec3(0.0) );
+                    }
+                }
+                indices[n++] = found.first->second;
+            }
+        }
+    }
+
+    // Release the per block data before filling the mesh
+    blocks.clear();
+
+    if (outPositions.size() > MAX_INDEX_VALUE) {
+        std::cout << "WARNING loadOBJ(): " << _file << " has " << outPositions.size() << " vertices, more than can be indexed (" << MAX_INDEX_VALUE << ")" << std::endl;
+    }
+
+    _mesh.clear();
+    _mesh.setDrawMode(GL_TRIANGLES);
+    _mesh.addVertices(std::move(outPositions));
+    _mesh.addColors(std::move(outColors));
+    _mesh.addTexCoords(std::move(outTexCoords));
+    _mesh.addIndices(std::move(indices));
+
+    if (bNormals) {
+        _mesh.addNormals(std::move(outNormals));
+    }
+    else {
+        _mesh.computeNormals();
+    }
+
+    return true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+#include "types/mesh.h"
+
+//  Load a Wavefront OBJ file into _mesh (replacing its content).
+//  The file is tokenized in blocks of lines on several threads, all faces are
+//  triangulated and the position/texcoord/normal tuples are deduplicated into a
+//  single indexed vertex buffer.
+bool loadOBJ(const std::string& _file, Mesh& _mesh);
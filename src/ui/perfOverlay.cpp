@@ -0,0 +1,75 @@
+#include "perfOverlay.h"
+
+#include <cfloat>
+#include <imgui/imgui.h>
+
+#include "gl/counters.h"
+
+//  What ImGui::PlotLines asks the measures of a section through, no copies are made
+struct PlotSource {
+    const FrameStats*   stats;
+    int                 section;
+};
+
+static float getPlotSample(void* _data, int _index) {
+    const PlotSource* source = (const PlotSource*)_data;
+    return source->stats->getSample(source->section, _index);
+}
+
+PerfOverlay::PerfOverlay(): m_cpuSection(-1), m_gpuSection(-1) {
+}
+
+PerfOverlay::~PerfOverlay() {
+}
+
+void PerfOverlay::setGraphs(int _cpuSection, int _gpuSection) {
+    m_cpuSection = _cpuSection;
+    m_gpuSection = _gpuSection;
+}
+
+void PerfOverlay::draw(bool* _open, const FrameStats& _stats, const ShaderStats& _shader, double _reloadTime) const {
+    if (!*_open) {
+        return;
+    }
+
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    if (!ImGui::Begin("Performance", _open, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav)) {
+        ImGui::End();
+        return;
+    }
+
+    // Frame times, oldest first, from 0 so the graphs compare
+    int graphs[2] = { m_cpuSection, m_gpuSection };
+    const char* labels[2] = { "CPU ms", "GPU ms" };
+    for (int i = 0; i < 2; i++) {
+        if (graphs[i] < 0 || _stats.getSamples(graphs[i]) == 0) {
+            continue;
+        }
+        PlotSource source = { &_stats, graphs[i] };
+        ImGui::PlotLines(labels[i], getPlotSample, &source, _stats.getSamples(graphs[i]), 0, NULL, 0.0f, FLT_MAX, ImVec2(0, 50));
+    }
+
+    ImGui::Separator();
+    for (int i = 0; i < _stats.size(); i++) {
+        if (_stats.getSamples(i) == 0) {
+            continue;
+        }
+        if (_stats.isCount(i)) {
+            ImGui::Text("%-12s %-10s %9d", _stats.getGroup(i).c_str(), _stats.getName(i).c_str(), (int)_stats.getLast(i));
+        }
+        else {
+            ImGui::Text("%-12s %-10s %9.3f", _stats.getGroup(i).c_str(), _stats.getName(i).c_str(), _stats.getLast(i));
+        }
+    }
+
+    ImGui::Separator();
+    ImGui::Text("textures %8.1f MB", glCounters.textureBytes / (1024.0 * 1024.0));
+    ImGui::Text("buffers  %8.1f MB", glCounters.bufferBytes / (1024.0 * 1024.0));
+
+    ImGui::Separator();
+    ImGui::Text("reload   %8.2f ms", _reloadTime);
+    ImGui::Text("compile  %8.2f ms", _shader.compileTime);
+    ImGui::Text("link     %8.2f ms", _shader.linkTime);
+
+    ImGui::End();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "gl/shader.h"
+#include "tools/frameStats.h"
+
+//  ImGui window with how the frames are doing: a graph of the CPU and GPU frame times, the last
+//  measure of every section of the FrameStats (passes, draw and uniform calls...), the GPU memory
+//  held and what the last shader (re)load took. It draws from the rings the FrameStats already
+//  keep, so it has nothing to do while hidden
+class PerfOverlay {
+public:
+    PerfOverlay();
+    virtual ~PerfOverlay();
+
+    //  Sections of the FrameStats plotted as the CPU and GPU frame times
+    void    setGraphs(int _cpuSection, int _gpuSection);
+
+    //  _reloadTime is the milliseconds the last reload of _shader took, with its buffers
+    void    draw(bool* _open, const FrameStats& _stats, const ShaderStats& _shader, double _reloadTime) const;
+
+private:
+    int     m_cpuSection;
+    int     m_gpuSection;
+};